@@ -0,0 +1,428 @@
+// Standalone benchmark of the search server. Build it from all sources except main.cpp, e.g.
+//   g++ -std=c++17 -O2 -I.. search_benchmark.cpp $(ls ../*.cpp | grep -v main.cpp) -ltbb -o search_benchmark
+// Usage: search_benchmark [--seed N] [--queries N] [--fuzzy-words N] [document_count...]
+// Every result is printed as one JSON object per line, latency percentiles only for rows with several measurements.
+
+#include "../fuzzy_index.h"
+#include "../persistent_search_server.h"
+#include "../process_queries.h"
+#include "../search_metrics.h"
+#include "../search_scheduler.h"
+#include "../search_server.h"
+#include "../test_example_functions.h"
+
+#include <algorithm>
+#include <chrono>
+#include <execution>
+#include <filesystem>
+#include <iostream>
+#include <random>
+#include <stdexcept>
+#include <string>
+#include <unordered_set>
+#include <vector>
+
+using namespace std;
+
+namespace {
+
+using Clock = chrono::steady_clock;
+
+struct BenchmarkConfig {
+    uint32_t seed = 42;
+    int query_count = 1'000;
+    int dictionary_size = 10'000;
+    int max_word_length = 10;
+    int document_word_count = 70;
+    int query_word_count = 10;
+    int remove_count = 100;
+    int match_count = 1'000;
+    // Documents added one by one with a sync per call
+    int durable_add_count = 1'000;
+    int ingest_batch_size = 1'000;
+    // Queries per measured call of ProcessQueries and SearchAsync
+    int query_batch_size = 100;
+    // Vocabulary of the large fuzzy matching benchmark, e.g. 1'000'000; 0 skips it
+    int fuzzy_word_count = 0;
+    int fuzzy_max_edit_distance = 2;
+    vector<int> document_counts;
+};
+
+class BenchmarkReport {
+public:
+    BenchmarkReport(string_view name, int document_count)
+        : name_(name)
+        , document_count_(document_count) {
+    }
+
+    // operation_count is the number of operations done by one call, e.g. queries of a batch
+    template <typename Operation>
+    void Measure(Operation operation, uint64_t operation_count = 1) {
+        const auto start_time = Clock::now();
+        operation();
+        const auto duration = Clock::now() - start_time;
+        total_time_ += duration;
+        operations_ += operation_count;
+        latencies_.Add(LatencyHistogram::GetBucketIndex(chrono::duration_cast<chrono::nanoseconds>(duration).count()), 1);
+    }
+
+    [[nodiscard]] Clock::duration GetTotalTime() const {
+        return total_time_;
+    }
+
+    void Print(ostream& out) const {
+        const double total_seconds = chrono::duration<double>(total_time_).count();
+        const uint64_t operations = operations_;
+        out << "{\"benchmark\": \""s << name_ << "\", "s
+            << "\"documents\": "s << document_count_ << ", "s
+            << "\"operations\": "s << operations << ", "s
+            << "\"total_ms\": "s << total_seconds * 1000 << ", "s
+            << "\"ops_per_sec\": "s << (total_seconds > 0 ? operations / total_seconds : 0);
+        // Percentiles of a single measurement are all the same number
+        if (latencies_.GetCount() < 2) {
+            out << "}"s << endl;
+            return;
+        }
+        out << ", "s
+            << "\"p50_us\": "s << latencies_.GetValueAtPercentile(50) / 1000.0 << ", "s
+            << "\"p90_us\": "s << latencies_.GetValueAtPercentile(90) / 1000.0 << ", "s
+            << "\"p99_us\": "s << latencies_.GetValueAtPercentile(99) / 1000.0 << ", "s
+            << "\"max_us\": "s << latencies_.GetValueAtPercentile(100) / 1000.0 << "}"s << endl;
+    }
+
+private:
+    string name_;
+    int document_count_;
+    Clock::duration total_time_ = {};
+    uint64_t operations_ = 0;
+    LatencyHistogram latencies_;
+};
+
+// Keeps results alive so the compiler cannot drop the measured calls
+double relevance_sink = 0;
+
+// Returns the total search time
+template <typename ExecutionPolicy>
+Clock::duration BenchmarkFindTopDocuments(string_view name, const SearchServer& search_server, const vector<string>& queries,
+                                          ExecutionPolicy&& policy) {
+    BenchmarkReport report(name, search_server.GetDocumentCount());
+    for (const string& query : queries) {
+        report.Measure([&] {
+            for (const Document& document : search_server.FindTopDocuments(policy, query)) {
+                relevance_sink += document.relevance;
+            }
+        });
+    }
+    report.Print(cout);
+    return report.GetTotalTime();
+}
+
+// Sequential FindTopDocuments without and with fuzzy matching, ratio is how many times fuzzy search is slower
+void BenchmarkFuzzySearch(string_view name, SearchServer& search_server, const vector<string>& queries, int max_edit_distance) {
+    const auto exact_time = BenchmarkFindTopDocuments(string(name) + "_exact"s, search_server, queries, execution::seq);
+    search_server.EnableFuzzyMatching(max_edit_distance);
+    const auto fuzzy_time = BenchmarkFindTopDocuments(string(name) + "_fuzzy"s, search_server, queries, execution::seq);
+    search_server.DisableFuzzyMatching();
+    const double query_count = max<size_t>(queries.size(), 1);
+    cout << "{\"benchmark\": \""s << name << "\", "s
+         << "\"documents\": "s << search_server.GetDocumentCount() << ", "s
+         << "\"exact_ms_per_query\": "s << chrono::duration<double, milli>(exact_time).count() / query_count << ", "s
+         << "\"fuzzy_ms_per_query\": "s << chrono::duration<double, milli>(fuzzy_time).count() / query_count << ", "s
+         << "\"ratio\": "s << chrono::duration<double>(fuzzy_time) / chrono::duration<double>(exact_time) << "}"s << endl;
+}
+
+// Compares impact search with the exact ranking: recall is the share of the exact top documents found,
+// same_order the share of queries with identical document lists. Impact search must return the same
+// documents in the same order, so anything below 1 throws
+void CheckImpactAccuracy(const SearchServer& search_server, const vector<string>& queries) {
+    double recall_sum = 0;
+    double min_recall = 1;
+    int same_order_count = 0;
+    for (const string& query : queries) {
+        const vector<Document> exact = search_server.FindTopDocuments(query);
+        const vector<Document> impact = search_server.FindTopDocumentsByImpact(query);
+        int found_count = 0;
+        for (const Document& document : exact) {
+            found_count += any_of(impact.begin(), impact.end(), [&document](const Document& other) { return other.id == document.id; });
+        }
+        const double recall = exact.empty() ? 1.0 : static_cast<double>(found_count) / exact.size();
+        recall_sum += recall;
+        min_recall = min(min_recall, recall);
+        same_order_count += equal(exact.begin(), exact.end(), impact.begin(), impact.end(),
+                                  [](const Document& lhs, const Document& rhs) { return lhs.id == rhs.id; });
+    }
+    const double query_count = max<size_t>(queries.size(), 1);
+    cout << "{\"benchmark\": \"impact_accuracy\", "s
+         << "\"documents\": "s << search_server.GetDocumentCount() << ", "s
+         << "\"queries\": "s << queries.size() << ", "s
+         << "\"mean_recall\": "s << recall_sum / query_count << ", "s
+         << "\"min_recall\": "s << min_recall << ", "s
+         << "\"same_order\": "s << same_order_count / query_count << "}"s << endl;
+    if (same_order_count != static_cast<int>(queries.size())) {
+        throw logic_error("FindTopDocumentsByImpact differs from FindTopDocuments"s);
+    }
+}
+
+void PrintIndexStatistics(string_view name, const IndexStatistics& statistics) {
+    cout << "{\"benchmark\": \""s << name << "\", "s
+         << "\"documents\": "s << statistics.document_count << ", "s
+         << "\"words\": "s << statistics.word_count << ", "s
+         << "\"postings\": "s << statistics.posting_count << ", "s
+         << "\"encoded_posting_bytes\": "s << statistics.encoded_posting_bytes << "}"s << endl;
+}
+
+template <typename ExecutionPolicy>
+void BenchmarkRemoveDocument(string_view name, SearchServer& search_server, int first_document_id, int remove_count,
+                             ExecutionPolicy&& policy) {
+    BenchmarkReport report(name, search_server.GetDocumentCount());
+    for (int document_id = first_document_id; document_id < first_document_id + remove_count; ++document_id) {
+        report.Measure([&] { search_server.RemoveDocument(policy, document_id); });
+    }
+    report.Print(cout);
+}
+
+// Adds to a PersistentSearchServer in a fresh directory, to compare with add_document of the in-memory server
+void BenchmarkLogIngest(const BenchmarkConfig& config, const string& stop_words, const vector<string>& documents) {
+    const int document_count = static_cast<int>(documents.size());
+    const filesystem::path directory = filesystem::temp_directory_path() / "search_benchmark_wal"s;
+    const auto run = [&](string_view name, PersistentSearchServer::Options options, auto add_documents) {
+        filesystem::remove_all(directory);
+        filesystem::create_directories(directory);
+        PersistentSearchServer search_server(stop_words, directory.string(), options);
+        BenchmarkReport report(name, document_count);
+        add_documents(search_server, report);
+        report.Print(cout);
+    };
+
+    run("wal_add_document"s, {}, [&](PersistentSearchServer& search_server, BenchmarkReport& report) {
+        for (int document_id = 0; document_id < min(config.durable_add_count, document_count); ++document_id) {
+            report.Measure([&] {
+                search_server.AddDocument(document_id, documents[document_id], DocumentStatus::ACTUAL, {1, 2, 3});
+            });
+        }
+    });
+    PersistentSearchServer::Options no_wait_options;
+    no_wait_options.wait_durable = false;
+    run("wal_add_document_no_wait"s, no_wait_options, [&](PersistentSearchServer& search_server, BenchmarkReport& report) {
+        for (int document_id = 0; document_id < document_count; ++document_id) {
+            report.Measure([&] {
+                search_server.AddDocument(document_id, documents[document_id], DocumentStatus::ACTUAL, {1, 2, 3});
+            });
+        }
+    });
+    run("wal_add_documents_batched"s, {}, [&](PersistentSearchServer& search_server, BenchmarkReport& report) {
+        vector<DocumentRecord> batch;
+        for (int batch_start = 0; batch_start < document_count; batch_start += config.ingest_batch_size) {
+            batch.clear();
+            for (int document_id = batch_start; document_id < min(batch_start + config.ingest_batch_size, document_count); ++document_id) {
+                batch.push_back({document_id, documents[document_id], DocumentStatus::ACTUAL, {1, 2, 3}});
+            }
+            report.Measure([&] { search_server.AddDocuments(batch); }, batch.size());
+        }
+    });
+    filesystem::remove_all(directory);
+}
+
+// FuzzyIndex over a large generated vocabulary: build time, size of the deletion table and latency of lookups
+// of misspelled vocabulary words, then fuzzy against exact search on a corpus using the whole vocabulary
+void BenchmarkFuzzyIndex(const BenchmarkConfig& config) {
+    mt19937 generator(config.seed);
+    // Short generated words repeat, so words are drawn until the vocabulary has the requested size
+    unordered_set<string> unique_words;
+    while (static_cast<int>(unique_words.size()) < config.fuzzy_word_count) {
+        unique_words.insert(GenerateWord(generator, config.max_word_length));
+    }
+    const vector<string> dictionary(unique_words.begin(), unique_words.end());
+    const int word_count = static_cast<int>(dictionary.size());
+
+    const auto misspell = [&generator](string word) {
+        word[uniform_int_distribution<size_t>(0, word.size() - 1)(generator)] = uniform_int_distribution('a', 'z')(generator);
+        return word;
+    };
+
+    // The standalone index is freed before the server builds its own one
+    {
+        FuzzyIndex fuzzy_index(config.fuzzy_max_edit_distance);
+        {
+            BenchmarkReport report("fuzzy_index_build"s, word_count);
+            report.Measure([&] {
+                for (const string& word : dictionary) {
+                    fuzzy_index.AddWord(word);
+                }
+            }, dictionary.size());
+            report.Print(cout);
+        }
+        cout << "{\"benchmark\": \"fuzzy_index_size\", "s
+             << "\"words\": "s << word_count << ", "s
+             << "\"max_edit_distance\": "s << config.fuzzy_max_edit_distance << ", "s
+             << "\"deletes\": "s << fuzzy_index.GetDeleteCount() << ", "s
+             << "\"memory_bytes\": "s << fuzzy_index.GetMemoryUsage() << "}"s << endl;
+    
+        BenchmarkReport report("fuzzy_index_lookup"s, word_count);
+        uint64_t found_count = 0;
+        for (int i = 0; i < config.query_count; ++i) {
+            const string word = misspell(dictionary[uniform_int_distribution<int>(0, word_count - 1)(generator)]);
+            report.Measure([&] { found_count += fuzzy_index.FindSimilarWords(word).size(); });
+        }
+        report.Print(cout);
+        relevance_sink += found_count;
+    }
+
+    // Twice as many words in documents as in the vocabulary, so most of it is used
+    SearchServer search_server(""s);
+    const int document_count = 2 * word_count / config.document_word_count;
+    for (int document_id = 0; document_id < document_count; ++document_id) {
+        search_server.AddDocument(document_id, GenerateQuery(generator, dictionary, config.document_word_count),
+                                  DocumentStatus::ACTUAL, {1, 2, 3});
+    }
+    vector<string> queries;
+    queries.reserve(config.query_count);
+    for (int i = 0; i < config.query_count; ++i) {
+        string query;
+        for (int j = 0; j < 3; ++j) {
+            query += (j > 0 ? " "s : ""s) + misspell(dictionary[uniform_int_distribution<int>(0, word_count - 1)(generator)]);
+        }
+        queries.push_back(move(query));
+    }
+    BenchmarkFuzzySearch("fuzzy_search_large_vocabulary"s, search_server, queries, config.fuzzy_max_edit_distance);
+}
+
+void RunBenchmarks(const BenchmarkConfig& config, int document_count) {
+    mt19937 generator(config.seed);
+    const auto dictionary = GenerateDictionary(generator, config.dictionary_size, config.max_word_length);
+    const auto documents = GenerateQueries(generator, dictionary, document_count, config.document_word_count);
+    const auto queries = GenerateQueries(generator, dictionary, config.query_count, config.query_word_count);
+
+    SearchServer search_server(dictionary[0]);
+    {
+        BenchmarkReport report("add_document"s, document_count);
+        for (int document_id = 0; document_id < document_count; ++document_id) {
+            report.Measure([&] {
+                search_server.AddDocument(document_id, documents[document_id], DocumentStatus::ACTUAL, {1, 2, 3});
+            });
+        }
+        report.Print(cout);
+    }
+    BenchmarkLogIngest(config, dictionary[0], documents);
+
+    BenchmarkFindTopDocuments("find_top_documents_seq"s, search_server, queries, execution::seq);
+    BenchmarkFindTopDocuments("find_top_documents_par"s, search_server, queries, execution::par);
+    BenchmarkFuzzySearch("fuzzy_search"s, search_server, queries, config.fuzzy_max_edit_distance);
+
+    {
+        BenchmarkReport report("build_impact_index"s, document_count);
+        report.Measure([&] { search_server.BuildImpactIndex(); });
+        report.Print(cout);
+    }
+    {
+        BenchmarkReport report("find_top_documents_impact"s, document_count);
+        for (const string& query : queries) {
+            report.Measure([&] {
+                for (const Document& document : search_server.FindTopDocumentsByImpact(query)) {
+                    relevance_sink += document.relevance;
+                }
+            });
+        }
+        report.Print(cout);
+    }
+    CheckImpactAccuracy(search_server, queries);
+
+    {
+        BenchmarkReport report("match_document"s, document_count);
+        for (int i = 0; i < config.match_count; ++i) {
+            const string& query = queries[i % queries.size()];
+            const int document_id = uniform_int_distribution<int>(0, document_count - 1)(generator);
+            report.Measure([&] {
+                const auto [words, status] = search_server.MatchDocument(query, document_id);
+                relevance_sink += words.size();
+            });
+        }
+        report.Print(cout);
+    }
+
+    // Latencies of these two are per batch of query_batch_size queries
+    vector<vector<string>> query_batches;
+    for (size_t batch_start = 0; batch_start < queries.size(); batch_start += config.query_batch_size) {
+        const size_t batch_end = min(batch_start + config.query_batch_size, queries.size());
+        query_batches.emplace_back(queries.begin() + batch_start, queries.begin() + batch_end);
+    }
+    {
+        BenchmarkReport report("process_queries"s, document_count);
+        for (const auto& query_batch : query_batches) {
+            report.Measure([&] {
+                for (const auto& documents_of_query : ProcessQueries(search_server, query_batch)) {
+                    relevance_sink += documents_of_query.size();
+                }
+            }, query_batch.size());
+        }
+        report.Print(cout);
+    }
+    {
+        // All queries of a batch are in flight at once, as with many concurrent clients, so the queue must hold them all
+        SchedulerOptions scheduler_options;
+        scheduler_options.queue_capacity = config.query_batch_size;
+        SearchScheduler scheduler(search_server, scheduler_options);
+        BenchmarkReport report("search_async"s, document_count);
+        vector<future<SearchResult>> results;
+        for (const auto& query_batch : query_batches) {
+            report.Measure([&] {
+                results.clear();
+                for (const string& query : query_batch) {
+                    results.push_back(scheduler.SearchAsync(query));
+                }
+                for (auto& result : results) {
+                    relevance_sink += result.get().documents.size();
+                }
+            }, query_batch.size());
+        }
+        report.Print(cout);
+    }
+
+    // Searched right before and after the reordering, so only the order of documents differs
+    PrintIndexStatistics("index_size"s, search_server.GetIndexStatistics());
+    BenchmarkFindTopDocuments("find_top_documents_seq_before_reorder"s, search_server, queries, execution::seq);
+    {
+        BenchmarkReport report("reorder_documents"s, document_count);
+        report.Measure([&] { search_server.ReorderDocuments(); });
+        report.Print(cout);
+    }
+    PrintIndexStatistics("index_size_reordered"s, search_server.GetIndexStatistics());
+    BenchmarkFindTopDocuments("find_top_documents_seq_reordered"s, search_server, queries, execution::seq);
+
+    const int remove_count = min(config.remove_count, document_count / 2);
+    BenchmarkRemoveDocument("remove_document_seq"s, search_server, 0, remove_count, execution::seq);
+    BenchmarkRemoveDocument("remove_document_par"s, search_server, remove_count, remove_count, execution::par);
+}
+
+} // namespace
+
+int main(int argc, char* argv[]) {
+    BenchmarkConfig config;
+    for (int i = 1; i < argc; ++i) {
+        const string argument = argv[i];
+        if (argument == "--seed"s && i + 1 < argc) {
+            config.seed = static_cast<uint32_t>(stoul(argv[++i]));
+        } else if (argument == "--queries"s && i + 1 < argc) {
+            config.query_count = stoi(argv[++i]);
+        } else if (argument == "--fuzzy-words"s && i + 1 < argc) {
+            config.fuzzy_word_count = stoi(argv[++i]);
+        } else {
+            config.document_counts.push_back(stoi(argument));
+        }
+    }
+    if (config.document_counts.empty()) {
+        config.document_counts = {10'000};
+    }
+
+    TestSearchSchedulerLoadShedding();
+    TestPersistentSearchServerRecovery();
+
+    for (const int document_count : config.document_counts) {
+        RunBenchmarks(config, document_count);
+    }
+    if (config.fuzzy_word_count > 0) {
+        BenchmarkFuzzyIndex(config);
+    }
+    cerr << "checksum: "s << relevance_sink << endl;
+    return 0;
+}
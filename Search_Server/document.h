@@ -1,6 +1,7 @@
 #pragma once
 
 #include <iostream>
+#include <string>
 
 struct Document {
     Document();
@@ -22,4 +23,10 @@ struct Document {
     int rating = 0;
 };
 
+// Document with the best window of its text, matched query words are highlighted
+struct DocumentSnippet {
+    Document document;
+    std::string snippet;
+};
+
 std::ostream &operator<<(std::ostream &out, const Document &document);
@@ -0,0 +1,250 @@
+#include "document_loader.h"
+
+#include <algorithm>
+#include <charconv>
+#include <condition_variable>
+#include <deque>
+#include <exception>
+#include <mutex>
+#include <optional>
+#include <stdexcept>
+#include <string>
+#include <string_view>
+#include <thread>
+#include <vector>
+
+using namespace std::string_literals;
+
+namespace {
+
+// Blocking queue of chunks. After Close, Push fails and Pop returns the remaining items, then nothing
+class ChunkQueue {
+public:
+    bool Push(std::string chunk) {
+        std::unique_lock lock(mutex_);
+        if (closed_) {
+            return false;
+        }
+        chunks_.push_back(std::move(chunk));
+        cv_.notify_one();
+        return true;
+    }
+
+    std::optional<std::string> Pop(std::atomic<uint64_t>* waits = nullptr) {
+        std::unique_lock lock(mutex_);
+        if (chunks_.empty() && !closed_ && waits != nullptr) {
+            ++*waits;
+        }
+        cv_.wait(lock, [this] { return !chunks_.empty() || closed_; });
+        if (chunks_.empty()) {
+            return std::nullopt;
+        }
+        std::string chunk = std::move(chunks_.front());
+        chunks_.pop_front();
+        return chunk;
+    }
+
+    void Close() {
+        std::unique_lock lock(mutex_);
+        closed_ = true;
+        cv_.notify_all();
+    }
+
+private:
+    std::mutex mutex_;
+    std::condition_variable cv_;
+    std::deque<std::string> chunks_;
+    bool closed_ = false;
+};
+
+std::string_view NextField(std::string_view& line) {
+    const size_t tab = line.find('\t');
+    if (tab == std::string_view::npos) {
+        throw std::invalid_argument("Not enough fields in record: "s + std::string(line.substr(0, 64)));
+    }
+    const std::string_view field = line.substr(0, tab);
+    line.remove_prefix(tab + 1);
+    return field;
+}
+
+int ParseInt(std::string_view text) {
+    int value = 0;
+    const auto [end, error] = std::from_chars(text.data(), text.data() + text.size(), value);
+    if (error != std::errc() || end != text.data() + text.size()) {
+        throw std::invalid_argument("Not valid number in record: "s + std::string(text));
+    }
+    return value;
+}
+
+DocumentStatus ParseStatus(std::string_view text) {
+    if (text == "ACTUAL") {
+        return DocumentStatus::ACTUAL;
+    }
+    if (text == "IRRELEVANT") {
+        return DocumentStatus::IRRELEVANT;
+    }
+    if (text == "BANNED") {
+        return DocumentStatus::BANNED;
+    }
+    if (text == "REMOVED") {
+        return DocumentStatus::REMOVED;
+    }
+    throw std::invalid_argument("Not valid document status in record: "s + std::string(text));
+}
+
+// Fills record in place, so the ratings buffer is reused between records
+void ParseRecord(std::string_view line, DocumentRecord& record) {
+    record.id = ParseInt(NextField(line));
+    record.status = ParseStatus(NextField(line));
+    std::string_view ratings = NextField(line);
+    record.ratings.clear();
+    while (!ratings.empty()) {
+        const size_t space = ratings.find(' ');
+        const std::string_view rating = ratings.substr(0, space);
+        if (!rating.empty()) {
+            record.ratings.push_back(ParseInt(rating));
+        }
+        ratings.remove_prefix(space == std::string_view::npos ? ratings.size() : space + 1);
+    }
+    record.text = line;
+}
+
+} // namespace
+
+size_t LoadDocuments(std::istream& input, const std::function<void(const DocumentRecord&)>& add_document,
+                     const LoaderOptions& options) {
+    if (options.chunk_size == 0 || options.queue_capacity == 0) {
+        throw std::invalid_argument("Chunk size and queue capacity must be positive");
+    }
+    const size_t worker_count = options.worker_count != 0
+            ? options.worker_count
+            : std::max<size_t>(std::thread::hardware_concurrency(), 1);
+    LoadProgress local_progress;
+    LoadProgress& progress = options.progress != nullptr ? *options.progress : local_progress;
+
+    // Chunks circulate between the two queues, so the reader stops once all of them are in use
+    ChunkQueue free_chunks;
+    ChunkQueue full_chunks;
+    for (size_t i = 0; i < options.queue_capacity + worker_count; ++i) {
+        free_chunks.Push(std::string());
+    }
+
+    std::atomic<size_t> added_count{0};
+    // Set on the first error, so the workers stop adding documents at once
+    std::atomic<bool> is_failed{false};
+    std::mutex error_mutex;
+    std::exception_ptr error;
+    const auto fail = [&](std::exception_ptr exception) {
+        is_failed = true;
+        {
+            std::lock_guard lock(error_mutex);
+            if (!error) {
+                error = exception;
+            }
+        }
+        full_chunks.Close();
+        free_chunks.Close();
+    };
+
+    std::vector<std::thread> workers;
+    workers.reserve(worker_count);
+    for (size_t i = 0; i < worker_count; ++i) {
+        workers.emplace_back([&] {
+            DocumentRecord record;
+            try {
+                while (std::optional<std::string> chunk = full_chunks.Pop()) {
+                    std::string_view rest = *chunk;
+                    while (!rest.empty() && !is_failed) {
+                        const size_t end_of_line = rest.find('\n');
+                        std::string_view line = rest.substr(0, end_of_line);
+                        rest.remove_prefix(end_of_line == std::string_view::npos ? rest.size() : end_of_line + 1);
+                        if (!line.empty() && line.back() == '\r') {
+                            line.remove_suffix(1);
+                        }
+                        if (line.empty()) {
+                            continue;
+                        }
+                        ParseRecord(line, record);
+                        ++progress.documents_parsed;
+                        if (is_failed) {
+                            break;
+                        }
+                        add_document(record);
+                        ++progress.documents_added;
+                        ++added_count;
+                    }
+                    if (!free_chunks.Push(std::move(*chunk))) {
+                        break;
+                    }
+                }
+            } catch (...) {
+                fail(std::current_exception());
+            }
+        });
+    }
+
+    try {
+        // Incomplete last line of the previous chunk
+        std::string carry;
+        while (true) {
+            std::optional<std::string> chunk = free_chunks.Pop(&progress.reader_waits);
+            if (!chunk) {
+                break;
+            }
+            chunk->assign(carry);
+            const size_t carry_size = chunk->size();
+            chunk->resize(carry_size + options.chunk_size);
+            input.read(chunk->data() + carry_size, static_cast<std::streamsize>(options.chunk_size));
+            const size_t read_size = static_cast<size_t>(input.gcount());
+            chunk->resize(carry_size + read_size);
+            progress.bytes_read += read_size;
+            if (input.bad()) {
+                throw std::runtime_error("Cannot read corpus");
+            }
+
+            if (input.eof()) {
+                if (!chunk->empty()) {
+                    full_chunks.Push(std::move(*chunk));
+                }
+                break;
+            }
+            const size_t last_line_end = chunk->rfind('\n');
+            if (last_line_end == std::string::npos) {
+                // The line is longer than a chunk, keep reading it
+                carry = std::move(*chunk);
+                free_chunks.Push(std::string());
+                continue;
+            }
+            carry.assign(*chunk, last_line_end + 1);
+            chunk->resize(last_line_end + 1);
+            if (!full_chunks.Push(std::move(*chunk))) {
+                break;
+            }
+        }
+    } catch (...) {
+        fail(std::current_exception());
+    }
+
+    full_chunks.Close();
+    for (std::thread& worker : workers) {
+        worker.join();
+    }
+    if (error) {
+        std::rethrow_exception(error);
+    }
+    return added_count;
+}
+
+size_t LoadDocuments(std::istream& input, SearchServer& search_server, const LoaderOptions& options) {
+    std::mutex mutex;
+    return LoadDocuments(input, [&](const DocumentRecord& document) {
+        std::lock_guard lock(mutex);
+        search_server.AddDocument(document.id, document.text, document.status, document.ratings);
+    }, options);
+}
+
+size_t LoadDocuments(std::istream& input, ShardedSearchServer& search_server, const LoaderOptions& options) {
+    return LoadDocuments(input, [&](const DocumentRecord& document) {
+        search_server.AddDocument(document.id, document.text, document.status, document.ratings);
+    }, options);
+}
@@ -0,0 +1,45 @@
+#pragma once
+
+#include <atomic>
+#include <cstdint>
+#include <functional>
+#include <istream>
+
+#include "search_server.h"
+#include "sharded_search_server.h"
+
+// Counters of a running load, may be read from another thread
+struct LoadProgress {
+    std::atomic<uint64_t> bytes_read{0};
+    std::atomic<uint64_t> documents_parsed{0};
+    std::atomic<uint64_t> documents_added{0};
+    // Times the reader waited for a free chunk because workers fell behind
+    std::atomic<uint64_t> reader_waits{0};
+};
+
+struct LoaderOptions {
+    size_t chunk_size = 1 << 20;
+    // Read chunks waiting for workers; together with the chunks being parsed it bounds the memory used
+    size_t queue_capacity = 8;
+    // 0 means one worker per hardware thread
+    size_t worker_count = 0;
+    LoadProgress* progress = nullptr;
+};
+
+// Loads a corpus with one document per line:
+//     id <TAB> status <TAB> ratings separated by spaces <TAB> text
+// where status is ACTUAL, IRRELEVANT, BANNED or REMOVED. Empty lines are skipped.
+// The input is read in large chunks on the calling thread and parsed by worker threads;
+// text of a record points into its chunk and is valid only during the call of add_document.
+// add_document is called concurrently from the workers. Returns the number of documents added.
+// The first error of reading, parsing or add_document stops the workers and is rethrown. Documents added
+// before it are not rolled back: the index holds a part of the corpus, which part depends on the order
+// the workers ran in, and progress.documents_added counts it
+size_t LoadDocuments(std::istream& input, const std::function<void(const DocumentRecord&)>& add_document,
+                     const LoaderOptions& options = {});
+
+// Parsing runs in parallel, AddDocument calls are serialized
+size_t LoadDocuments(std::istream& input, SearchServer& search_server, const LoaderOptions& options = {});
+
+// Documents of different shards are added in parallel
+size_t LoadDocuments(std::istream& input, ShardedSearchServer& search_server, const LoaderOptions& options = {});
@@ -0,0 +1,210 @@
+#include "document_store.h"
+
+#include <algorithm>
+#include <cstring>
+#include <limits>
+#include <stdexcept>
+
+using namespace std::string_literals;
+
+namespace {
+
+constexpr size_t kMinMatch = 4;
+constexpr size_t kMaxOffset = 65535;
+constexpr size_t kHashBits = 12;
+
+uint32_t ReadUint32(const char* data) {
+    uint32_t value;
+    std::memcpy(&value, data, sizeof(value));
+    return value;
+}
+
+size_t HashUint32(uint32_t value) {
+    return (value * 2654435761u) >> (32 - kHashBits);
+}
+
+void WriteLength(std::string& out, size_t length) {
+    while (length >= 255) {
+        out.push_back(static_cast<char>(255));
+        length -= 255;
+    }
+    out.push_back(static_cast<char>(length));
+}
+
+size_t ReadLength(std::string_view input, size_t& pos, size_t length) {
+    uint8_t byte = 255;
+    while (byte == 255) {
+        if (pos >= input.size()) {
+            throw std::runtime_error("Corrupted compressed block"s);
+        }
+        byte = static_cast<uint8_t>(input[pos++]);
+        length += byte;
+    }
+    return length;
+}
+
+void WriteSequence(std::string& out, std::string_view literals, size_t offset, size_t match_length) {
+    const size_t match_code = match_length == 0 ? 0 : match_length - kMinMatch;
+    const uint8_t token = static_cast<uint8_t>((std::min<size_t>(literals.size(), 15) << 4) | std::min<size_t>(match_code, 15));
+    out.push_back(static_cast<char>(token));
+    if (literals.size() >= 15) {
+        WriteLength(out, literals.size() - 15);
+    }
+    out.append(literals);
+    if (match_length == 0) {
+        return;
+    }
+    out.push_back(static_cast<char>(offset & 0xFF));
+    out.push_back(static_cast<char>(offset >> 8));
+    if (match_code >= 15) {
+        WriteLength(out, match_code - 15);
+    }
+}
+
+} // namespace
+
+std::string CompressBlock(std::string_view input) {
+    std::string out;
+    out.reserve(input.size() / 2 + 16);
+    std::vector<int64_t> table(size_t{1} << kHashBits, -1);
+
+    size_t anchor = 0;
+    size_t pos = 0;
+    while (pos + kMinMatch <= input.size()) {
+        const uint32_t sequence = ReadUint32(input.data() + pos);
+        const size_t hash = HashUint32(sequence);
+        const int64_t candidate = table[hash];
+        table[hash] = static_cast<int64_t>(pos);
+
+        if (candidate < 0 || pos - candidate > kMaxOffset || ReadUint32(input.data() + candidate) != sequence) {
+            ++pos;
+            continue;
+        }
+
+        size_t match_length = kMinMatch;
+        while (pos + match_length < input.size() && input[candidate + match_length] == input[pos + match_length]) {
+            ++match_length;
+        }
+        WriteSequence(out, input.substr(anchor, pos - anchor), pos - candidate, match_length);
+        pos += match_length;
+        anchor = pos;
+    }
+    WriteSequence(out, input.substr(anchor), 0, 0);
+    return out;
+}
+
+std::string DecompressBlock(std::string_view input, size_t limit) {
+    std::string out;
+    size_t pos = 0;
+    while (pos < input.size() && out.size() < limit) {
+        const uint8_t token = static_cast<uint8_t>(input[pos++]);
+        size_t literal_length = token >> 4;
+        if (literal_length == 15) {
+            literal_length = ReadLength(input, pos, literal_length);
+        }
+        if (pos + literal_length > input.size()) {
+            throw std::runtime_error("Corrupted compressed block"s);
+        }
+        out.append(input.substr(pos, literal_length));
+        pos += literal_length;
+        if (pos == input.size()) {
+            break;
+        }
+
+        if (pos + 2 > input.size()) {
+            throw std::runtime_error("Corrupted compressed block"s);
+        }
+        const size_t offset = static_cast<uint8_t>(input[pos]) | (static_cast<size_t>(static_cast<uint8_t>(input[pos + 1])) << 8);
+        pos += 2;
+        size_t match_length = token & 0x0F;
+        if (match_length == 15) {
+            match_length = ReadLength(input, pos, match_length);
+        }
+        match_length += kMinMatch;
+        if (offset == 0 || offset > out.size()) {
+            throw std::runtime_error("Corrupted compressed block"s);
+        }
+        // Byte by byte: a match may overlap the bytes it produces
+        const size_t match_start = out.size() - offset;
+        for (size_t i = 0; i < match_length; ++i) {
+            out.push_back(out[match_start + i]);
+        }
+    }
+    return out;
+}
+
+DocumentStore::DocumentStore(size_t block_size)
+    : block_size_(block_size) {
+}
+
+void DocumentStore::AddDocument(int document_id, std::string_view text) {
+    if (locations_.count(document_id) > 0) {
+        throw std::invalid_argument("Document is already stored"s);
+    }
+    if (!open_block_.empty() && open_block_.size() + text.size() > block_size_) {
+        SealOpenBlock();
+    }
+    locations_[document_id] = {blocks_.size(), static_cast<uint32_t>(open_block_.size()), static_cast<uint32_t>(text.size())};
+    open_block_.append(text);
+    stored_size_ += text.size();
+    // Oversized texts get a block of their own
+    if (open_block_.size() >= block_size_) {
+        SealOpenBlock();
+    }
+}
+
+void DocumentStore::RemoveDocument(int document_id) {
+    // Space inside sealed blocks is not reclaimed
+    locations_.erase(document_id);
+}
+
+[[nodiscard]] bool DocumentStore::HasDocument(int document_id) const {
+    return locations_.count(document_id) > 0;
+}
+
+[[nodiscard]] std::string DocumentStore::GetDocumentText(int document_id) const {
+    const auto it = locations_.find(document_id);
+    if (it == locations_.end()) {
+        throw std::out_of_range("Document text is not stored"s);
+    }
+    const Location& location = it->second;
+    if (location.block == blocks_.size()) {
+        return open_block_.substr(location.offset, location.size);
+    }
+    const std::string block = DecompressBlock(blocks_[location.block], location.offset + location.size);
+    return block.substr(location.offset, location.size);
+}
+
+void DocumentStore::ForEachDocument(const std::function<void(int, std::string_view)>& handler) const {
+    std::vector<std::pair<Location, int>> texts;
+    texts.reserve(locations_.size());
+    for (const auto& [document_id, location] : locations_) {
+        texts.emplace_back(location, document_id);
+    }
+    sort(texts.begin(), texts.end(), [](const auto& lhs, const auto& rhs) {
+        return std::pair(lhs.first.block, lhs.first.offset) < std::pair(rhs.first.block, rhs.first.offset);
+    });
+
+    std::string block;
+    size_t block_index = blocks_.size();
+    for (const auto& [location, document_id] : texts) {
+        if (location.block != block_index && location.block < blocks_.size()) {
+            block = DecompressBlock(blocks_[location.block], std::numeric_limits<size_t>::max());
+            block_index = location.block;
+        }
+        const std::string_view block_text = location.block == blocks_.size() ? std::string_view(open_block_) : std::string_view(block);
+        handler(document_id, block_text.substr(location.offset, location.size));
+    }
+}
+
+[[nodiscard]] size_t DocumentStore::GetStoredSize() const {
+    return stored_size_;
+}
+
+void DocumentStore::SealOpenBlock() {
+    std::string compressed = CompressBlock(open_block_);
+    stored_size_ -= open_block_.size();
+    stored_size_ += compressed.size();
+    blocks_.push_back(std::move(compressed));
+    open_block_.clear();
+}
@@ -0,0 +1,57 @@
+#pragma once
+
+#include <cstdint>
+#include <functional>
+#include <map>
+#include <string>
+#include <string_view>
+#include <vector>
+
+// Block compressor in the spirit of LZ4: sequences of literals followed by a back reference
+// within a 64 KB window
+std::string CompressBlock(std::string_view input);
+
+// Decompresses until at least limit bytes are produced (or the whole block if limit is larger)
+std::string DecompressBlock(std::string_view input, size_t limit);
+
+// Original document texts packed into compressed blocks. A text never spans two blocks,
+// so reading it back costs decompression of a single block prefix
+class DocumentStore {
+public:
+    explicit DocumentStore(size_t block_size = kDefaultBlockSize);
+
+    void AddDocument(int document_id, std::string_view text);
+
+    void RemoveDocument(int document_id);
+
+    [[nodiscard]] bool HasDocument(int document_id) const;
+
+    [[nodiscard]] std::string GetDocumentText(int document_id) const;
+
+    // Calls handler for every stored text in the order of addition, decompressing each block once
+    void ForEachDocument(const std::function<void(int, std::string_view)>& handler) const;
+
+    // Bytes occupied by texts, compressed blocks plus the not yet sealed one
+    [[nodiscard]] size_t GetStoredSize() const;
+
+private:
+    struct Location {
+        size_t block = 0;
+        uint32_t offset = 0;
+        uint32_t size = 0;
+    };
+
+private:
+    static constexpr size_t kDefaultBlockSize = 64 * 1024;
+
+private:
+    void SealOpenBlock();
+
+private:
+    size_t block_size_;
+    std::vector<std::string> blocks_;
+    // Texts are appended here until the block is full
+    std::string open_block_;
+    size_t stored_size_ = 0;
+    std::map<int, Location> locations_;
+};
@@ -0,0 +1,112 @@
+#include "fuzzy_index.h"
+
+#include <algorithm>
+#include <functional>
+#include <unordered_set>
+
+int ComputeEditDistance(std::string_view lhs, std::string_view rhs, int max_distance) {
+    if (lhs.size() > rhs.size()) {
+        std::swap(lhs, rhs);
+    }
+    if (static_cast<int>(rhs.size() - lhs.size()) > max_distance) {
+        return max_distance + 1;
+    }
+
+    std::vector<int> previous(lhs.size() + 1);
+    std::vector<int> current(lhs.size() + 1);
+    for (size_t i = 0; i <= lhs.size(); ++i) {
+        previous[i] = static_cast<int>(i);
+    }
+
+    for (size_t j = 1; j <= rhs.size(); ++j) {
+        current[0] = static_cast<int>(j);
+        int row_min = current[0];
+        for (size_t i = 1; i <= lhs.size(); ++i) {
+            const int substitution = previous[i - 1] + (lhs[i - 1] == rhs[j - 1] ? 0 : 1);
+            current[i] = std::min({previous[i] + 1, current[i - 1] + 1, substitution});
+            row_min = std::min(row_min, current[i]);
+        }
+        // No cell of the next rows can be smaller than the minimum of this one
+        if (row_min > max_distance) {
+            return max_distance + 1;
+        }
+        std::swap(previous, current);
+    }
+
+    return std::min(previous[lhs.size()], max_distance + 1);
+}
+
+FuzzyIndex::FuzzyIndex(int max_edit_distance)
+    : max_edit_distance_(max_edit_distance) {
+}
+
+void FuzzyIndex::AddWord(std::string_view word) {
+    for (const std::string& deleted : GenerateDeletes(word, max_edit_distance_)) {
+        deletes_[std::hash<std::string>{}(deleted)].push_back(word);
+    }
+}
+
+[[nodiscard]] std::vector<std::pair<std::string_view, int>> FuzzyIndex::FindSimilarWords(std::string_view word) const {
+    return FindSimilarWords(word, max_edit_distance_);
+}
+
+[[nodiscard]] std::vector<std::pair<std::string_view, int>> FuzzyIndex::FindSimilarWords(std::string_view word, int max_distance) const {
+    max_distance = std::min(max_distance, max_edit_distance_);
+    std::vector<std::pair<std::string_view, int>> result;
+    std::unordered_set<std::string_view> checked;
+    // A word within max_distance shares a delete of at most max_distance characters with the query word
+    for (const std::string& deleted : GenerateDeletes(word, max_distance)) {
+        const auto it = deletes_.find(std::hash<std::string>{}(deleted));
+        if (it == deletes_.end()) {
+            continue;
+        }
+        for (std::string_view candidate : it->second) {
+            // Lists of short deletes are long, the cheap length check goes before the set
+            const size_t length_difference = candidate.size() > word.size() ? candidate.size() - word.size() : word.size() - candidate.size();
+            if (length_difference > static_cast<size_t>(max_distance) || !checked.insert(candidate).second) {
+                continue;
+            }
+            const int distance = ComputeEditDistance(word, candidate, max_distance);
+            if (distance <= max_distance) {
+                result.emplace_back(candidate, distance);
+            }
+        }
+    }
+    return result;
+}
+
+[[nodiscard]] int FuzzyIndex::GetMaxEditDistance() const {
+    return max_edit_distance_;
+}
+
+[[nodiscard]] size_t FuzzyIndex::GetDeleteCount() const {
+    return deletes_.size();
+}
+
+[[nodiscard]] size_t FuzzyIndex::GetMemoryUsage() const {
+    // A node holds the element and the next pointer, libstdc++ also caches the hash
+    constexpr size_t kNodeSize = sizeof(void*) + sizeof(decltype(deletes_)::value_type) + sizeof(size_t);
+    size_t result = deletes_.bucket_count() * sizeof(void*) + deletes_.size() * kNodeSize;
+    for (const auto& [_, words] : deletes_) {
+        result += words.capacity() * sizeof(std::string_view);
+    }
+    return result;
+}
+
+[[nodiscard]] std::vector<std::string> FuzzyIndex::GenerateDeletes(std::string_view word, int max_distance) const {
+    std::unordered_set<std::string> deletes = {std::string(word.substr(0, kPrefixLength))};
+    std::vector<std::string> level(deletes.begin(), deletes.end());
+    for (int distance = 0; distance < max_distance; ++distance) {
+        std::vector<std::string> next_level;
+        for (const std::string& current : level) {
+            for (size_t i = 0; i < current.size(); ++i) {
+                std::string deleted = current.substr(0, i) + current.substr(i + 1);
+                if (deletes.insert(deleted).second) {
+                    next_level.push_back(std::move(deleted));
+                }
+            }
+        }
+        level = std::move(next_level);
+    }
+    return {deletes.begin(), deletes.end()};
+}
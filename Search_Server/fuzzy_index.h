@@ -0,0 +1,47 @@
+#pragma once
+
+#include <cstdint>
+#include <string>
+#include <string_view>
+#include <unordered_map>
+#include <utility>
+#include <vector>
+
+// Levenshtein distance between lhs and rhs, or max_distance + 1 if it is greater than max_distance
+int ComputeEditDistance(std::string_view lhs, std::string_view rhs, int max_distance);
+
+// SymSpell-style deletion index: every word is registered under all strings obtained by deleting
+// up to max_edit_distance characters from its prefix, so similar words are found by a few hash lookups
+// instead of a scan over the whole vocabulary
+class FuzzyIndex {
+public:
+    explicit FuzzyIndex(int max_edit_distance);
+
+    // word must outlive the index
+    void AddWord(std::string_view word);
+
+    // Dictionary words within max_edit_distance of word together with their distance
+    [[nodiscard]] std::vector<std::pair<std::string_view, int>> FindSimilarWords(std::string_view word) const;
+
+    // Same with a smaller distance, which also takes fewer lookups
+    [[nodiscard]] std::vector<std::pair<std::string_view, int>> FindSimilarWords(std::string_view word, int max_distance) const;
+
+    [[nodiscard]] int GetMaxEditDistance() const;
+
+    // Number of distinct deletion hashes
+    [[nodiscard]] size_t GetDeleteCount() const;
+
+    // Estimate of the heap memory of the deletion table: buckets, nodes and word lists
+    [[nodiscard]] size_t GetMemoryUsage() const;
+
+private:
+    static constexpr size_t kPrefixLength = 7;
+
+private:
+    [[nodiscard]] std::vector<std::string> GenerateDeletes(std::string_view word, int max_distance) const;
+
+private:
+    int max_edit_distance_;
+    // hash of delete -> words; hash collisions only add candidates which are verified anyway
+    std::unordered_map<uint64_t, std::vector<std::string_view>> deletes_;
+};
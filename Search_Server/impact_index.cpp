@@ -0,0 +1,42 @@
+#include "impact_index.h"
+
+#include <algorithm>
+#include <cmath>
+#include <functional>
+
+ImpactIndex::ImpactIndex(double max_impact)
+    : quantum_(max_impact > 0 ? max_impact / kImpactLevels : 1.0) {
+}
+
+void ImpactIndex::AddWord(std::string_view word, const std::vector<std::pair<int, double>>& document_impacts) {
+    std::map<uint8_t, std::vector<std::pair<int, double>>, std::greater<>> impact_to_documents;
+    for (const auto& [document_id, impact] : document_impacts) {
+        const long level = std::lround(impact / quantum_);
+        impact_to_documents[static_cast<uint8_t>(std::clamp<long>(level, 0, kImpactLevels))].emplace_back(document_id, impact);
+    }
+
+    std::vector<Segment>& segments = word_to_segments_[word];
+    segments.clear();
+    segments.reserve(impact_to_documents.size());
+    for (auto& [impact, documents] : impact_to_documents) {
+        // document_impacts come in the order of posting lists, which is not the order of ids
+        std::sort(documents.begin(), documents.end());
+        Segment& segment = segments.emplace_back();
+        segment.impact = impact;
+        segment.document_ids.reserve(documents.size());
+        segment.scores.reserve(documents.size());
+        for (const auto& [document_id, score] : documents) {
+            segment.document_ids.push_back(document_id);
+            segment.scores.push_back(score);
+        }
+    }
+}
+
+[[nodiscard]] const std::vector<ImpactIndex::Segment>* ImpactIndex::FindSegments(std::string_view word) const {
+    const auto it = word_to_segments_.find(word);
+    return it == word_to_segments_.end() ? nullptr : &it->second;
+}
+
+[[nodiscard]] double ImpactIndex::GetImpactQuantum() const {
+    return quantum_;
+}
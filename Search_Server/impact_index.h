@@ -0,0 +1,39 @@
+#pragma once
+
+#include <cstdint>
+#include <map>
+#include <string_view>
+#include <utility>
+#include <vector>
+
+// Posting lists ordered by impact (tf * idf quantized to 255 levels) instead of document id.
+// Every list is split into segments of documents with equal impact, the highest impact first.
+// The exact tf * idf of a document differs from impact * quantum by at most half a quantum
+class ImpactIndex {
+public:
+    struct Segment {
+        uint8_t impact = 0;
+        std::vector<int> document_ids;
+        // Exact tf * idf of every document of document_ids
+        std::vector<double> scores;
+    };
+
+    // max_impact is the largest tf * idf of the corpus, it gets the highest level
+    explicit ImpactIndex(double max_impact);
+
+    // word must outlive the index
+    void AddWord(std::string_view word, const std::vector<std::pair<int, double>>& document_impacts);
+
+    // nullptr if the word is not indexed
+    [[nodiscard]] const std::vector<Segment>* FindSegments(std::string_view word) const;
+
+    // tf * idf represented by one impact level
+    [[nodiscard]] double GetImpactQuantum() const;
+
+private:
+    static constexpr int kImpactLevels = 255;
+
+private:
+    double quantum_;
+    std::map<std::string_view, std::vector<Segment>> word_to_segments_;
+};
@@ -6,13 +6,9 @@
 #include <string>
 #include <vector>
 
-#include "test_example_functions.h"
-
 using namespace std;
 
 int main() {
-    Test1();
-
     SearchServer search_server("and with"s);
 
     int id = 0;
@@ -0,0 +1,193 @@
+#include "persistent_search_server.h"
+
+#include <algorithm>
+#include <cerrno>
+#include <cstdio>
+#include <cstring>
+#include <exception>
+#include <stdexcept>
+
+#include <fcntl.h>
+#include <unistd.h>
+
+using namespace std::string_literals;
+
+namespace {
+
+// Makes a rename in the directory of path durable
+void SyncParentDirectory(const std::string& path) {
+    const size_t slash = path.rfind('/');
+    const std::string directory = slash == std::string::npos ? "."s : slash == 0 ? "/"s : path.substr(0, slash);
+    const int fd = open(directory.c_str(), O_RDONLY | O_DIRECTORY);
+    if (fd < 0) {
+        throw std::runtime_error("Cannot open "s + directory + ": "s + std::strerror(errno));
+    }
+    if (fsync(fd) != 0) {
+        const int error = errno;
+        close(fd);
+        throw std::runtime_error("Cannot sync "s + directory + ": "s + std::strerror(error));
+    }
+    close(fd);
+}
+
+void WriteFileDurably(const std::string& path, const std::string& data) {
+    const std::string temporary_path = path + ".tmp"s;
+    const int fd = open(temporary_path.c_str(), O_WRONLY | O_CREAT | O_TRUNC, 0644);
+    if (fd < 0) {
+        throw std::runtime_error("Cannot create "s + temporary_path + ": "s + std::strerror(errno));
+    }
+    size_t written = 0;
+    while (written < data.size()) {
+        const ssize_t result = write(fd, data.data() + written, data.size() - written);
+        if (result < 0 && errno != EINTR) {
+            close(fd);
+            throw std::runtime_error("Cannot write "s + temporary_path + ": "s + std::strerror(errno));
+        }
+        written += result < 0 ? 0 : static_cast<size_t>(result);
+    }
+    if (fsync(fd) != 0 || close(fd) != 0) {
+        throw std::runtime_error("Cannot sync "s + temporary_path + ": "s + std::strerror(errno));
+    }
+    // The new snapshot replaces the old one atomically
+    if (std::rename(temporary_path.c_str(), path.c_str()) != 0) {
+        throw std::runtime_error("Cannot rename "s + temporary_path + ": "s + std::strerror(errno));
+    }
+    // Otherwise the rename may be lost in a crash after the log is emptied
+    SyncParentDirectory(path);
+}
+
+} // namespace
+
+PersistentSearchServer::PersistentSearchServer(std::string_view stop_words_text, const std::string& directory)
+    : PersistentSearchServer(stop_words_text, directory, Options{}) {
+}
+
+PersistentSearchServer::PersistentSearchServer(std::string_view stop_words_text, const std::string& directory, Options options)
+    : snapshot_path_(directory + "/snapshot"s)
+    , log_path_(directory + "/wal"s)
+    , options_(options)
+    , search_server_(stop_words_text) {
+    search_server_.EnableDocumentStore();
+    LoadSnapshot();
+    ReadLogRecords(log_path_, [this](const LogRecord& record) { ApplyLogRecord(record); });
+    log_ = std::make_unique<WriteAheadLog>(log_path_, options_.log);
+}
+
+void PersistentSearchServer::AddDocument(int document_id, std::string_view document, DocumentStatus status, const std::vector<int>& ratings) {
+    uint64_t lsn;
+    {
+        std::lock_guard guard(mutex_);
+        lsn = AddDocumentLocked(document_id, document, status, ratings);
+        if (CheckpointIfDueLocked(1)) {
+            return;
+        }
+    }
+    WaitDurable(lsn);
+}
+
+void PersistentSearchServer::AddDocuments(const std::vector<DocumentRecord>& documents) {
+    uint64_t lsn = 0;
+    std::exception_ptr error;
+    {
+        std::lock_guard guard(mutex_);
+        size_t added_count = 0;
+        try {
+            for (const DocumentRecord& document : documents) {
+                lsn = AddDocumentLocked(document.id, document.text, document.status, document.ratings);
+                ++added_count;
+            }
+        } catch (...) {
+            error = std::current_exception();
+        }
+        if (CheckpointIfDueLocked(added_count)) {
+            lsn = 0;
+        }
+    }
+    if (lsn != 0) {
+        WaitDurable(lsn);
+    }
+    if (error) {
+        std::rethrow_exception(error);
+    }
+}
+
+void PersistentSearchServer::RemoveDocument(int document_id) {
+    uint64_t lsn;
+    {
+        std::lock_guard guard(mutex_);
+        lsn = log_->AppendRemove(document_id);
+        search_server_.RemoveDocument(document_id);
+        if (CheckpointIfDueLocked(1)) {
+            return;
+        }
+    }
+    WaitDurable(lsn);
+}
+
+void PersistentSearchServer::Checkpoint() {
+    std::lock_guard guard(mutex_);
+    CheckpointLocked();
+}
+
+[[nodiscard]] const SearchServer& PersistentSearchServer::GetSearchServer() const {
+    return search_server_;
+}
+
+void PersistentSearchServer::LoadSnapshot() {
+    // A snapshot is complete once renamed, so a bad record is corruption rather than a torn write
+    ReadLogRecords(snapshot_path_, [this](const LogRecord& record) { ApplyLogRecord(record); }, LogReadMode::STRICT);
+}
+
+void PersistentSearchServer::ApplyLogRecord(const LogRecord& record) {
+    // A crash between writing a snapshot and emptying the log leaves records already in the snapshot,
+    // replaying an addition of a present document is skipped to stay idempotent
+    const bool is_present = std::binary_search(search_server_.begin(), search_server_.end(), record.document_id);
+    if (record.type == LogRecord::Type::ADD) {
+        if (is_present) {
+            return;
+        }
+        search_server_.AddDocument(record.document_id, record.text, record.status, record.ratings);
+    } else {
+        search_server_.RemoveDocument(record.document_id);
+    }
+}
+
+uint64_t PersistentSearchServer::AddDocumentLocked(int document_id, std::string_view document, DocumentStatus status,
+                                                  const std::vector<int>& ratings) {
+    // Invalid documents throw here and never reach the log
+    search_server_.AddDocument(document_id, document, status, ratings);
+    try {
+        return log_->AppendAdd(document_id, document, status, ratings);
+    } catch (...) {
+        // A document missing from the log would be lost on restart, so it must not be searchable either
+        search_server_.RemoveDocument(document_id);
+        throw;
+    }
+}
+
+bool PersistentSearchServer::CheckpointIfDueLocked(size_t update_count) {
+    updates_since_checkpoint_ += update_count;
+    if (options_.checkpoint_interval == 0 || updates_since_checkpoint_ < options_.checkpoint_interval) {
+        return false;
+    }
+    CheckpointLocked();
+    return true;
+}
+
+void PersistentSearchServer::CheckpointLocked() {
+    // A snapshot is a log of additions of the current documents, the average rating stands for the ratings
+    std::string snapshot;
+    search_server_.ForEachDocumentText([this, &snapshot](int document_id, std::string_view text) {
+        SerializeLogRecord(snapshot, LogRecord::Type::ADD, document_id, search_server_.GetDocumentStatus(document_id),
+                           {search_server_.GetDocumentRating(document_id)}, text);
+    });
+    WriteFileDurably(snapshot_path_, snapshot);
+    log_->Truncate();
+    updates_since_checkpoint_ = 0;
+}
+
+void PersistentSearchServer::WaitDurable(uint64_t lsn) {
+    if (options_.wait_durable) {
+        log_->WaitDurable(lsn);
+    }
+}
@@ -0,0 +1,69 @@
+#pragma once
+
+#include <memory>
+#include <mutex>
+#include <string>
+#include <string_view>
+#include <vector>
+
+#include "search_server.h"
+#include "write_ahead_log.h"
+
+// SearchServer whose updates survive a restart. The directory holds the last snapshot of all
+// documents and the write-ahead log of updates made after it; both are replayed on construction.
+// The document store is enabled, since snapshots are written from the stored texts
+class PersistentSearchServer {
+public:
+    struct Options {
+        WriteAheadLog::Options log;
+        // Return from updates only after their log record is on disk
+        bool wait_durable = true;
+        // Updates between automatic checkpoints, 0 disables them
+        size_t checkpoint_interval = 0;
+    };
+
+    PersistentSearchServer(std::string_view stop_words_text, const std::string& directory);
+
+    PersistentSearchServer(std::string_view stop_words_text, const std::string& directory, Options options);
+
+    // Safe to call concurrently: the index is updated under a lock, while waiting
+    // for the disk is shared by all writers of a batch. A single writer waits for one sync
+    // per call, so bulk ingest should use AddDocuments
+    void AddDocument(int document_id, std::string_view document, DocumentStatus status, const std::vector<int>& ratings);
+
+    // Adds all documents and waits for the disk once. If a document is invalid or cannot be logged,
+    // the documents before it stay added and the exception is rethrown after they are on disk
+    void AddDocuments(const std::vector<DocumentRecord>& documents);
+
+    void RemoveDocument(int document_id);
+
+    // Saves all documents to a new snapshot and empties the log
+    void Checkpoint();
+
+    // Searches must not run concurrently with updates
+    [[nodiscard]] const SearchServer& GetSearchServer() const;
+
+private:
+    void LoadSnapshot();
+
+    void ApplyLogRecord(const LogRecord& record);
+
+    // Returns the log sequence number of the record
+    uint64_t AddDocumentLocked(int document_id, std::string_view document, DocumentStatus status, const std::vector<int>& ratings);
+
+    // Takes a checkpoint if it is due, returns whether it was taken
+    bool CheckpointIfDueLocked(size_t update_count);
+
+    void CheckpointLocked();
+
+    void WaitDurable(uint64_t lsn);
+
+private:
+    const std::string snapshot_path_;
+    const std::string log_path_;
+    const Options options_;
+    std::mutex mutex_;
+    SearchServer search_server_;
+    size_t updates_since_checkpoint_ = 0;
+    std::unique_ptr<WriteAheadLog> log_;
+};
@@ -1,8 +1,17 @@
 #include "process_queries.h"
 
 #include <execution>
+#include <numeric>
+#include <string_view>
 #include <utility>
 
+namespace {
+
+// Large enough for popular words to be shared, small enough to keep relevance of the batch in cache
+constexpr size_t kQueryBatchSize = 256;
+
+} // namespace
+
 std::vector<std::vector<Document>> ProcessQueries(
         const SearchServer& search_server,
         const std::vector<std::string>& queries) {
@@ -18,6 +27,46 @@ std::vector<std::vector<Document>> ProcessQueries(
     return result;
 }
 
+std::vector<std::vector<Document>> ProcessQueriesBatched(
+        const SearchServer& search_server,
+        const std::vector<std::string>& queries) {
+
+    std::vector<std::vector<Document>> result(queries.size());
+    std::vector<size_t> batch_starts((queries.size() + kQueryBatchSize - 1) / kQueryBatchSize);
+    std::iota(batch_starts.begin(), batch_starts.end(), 0);
+    for (size_t& batch_start : batch_starts) {
+        batch_start *= kQueryBatchSize;
+    }
+    for_each(
+            execution::par,
+            batch_starts.begin(), batch_starts.end(),
+            [&search_server, &queries, &result](size_t batch_start) {
+                const size_t batch_end = std::min(batch_start + kQueryBatchSize, queries.size());
+                const std::vector<std::string_view> batch_queries(queries.begin() + batch_start, queries.begin() + batch_end);
+                auto batch_result = search_server.FindTopDocumentsBatch(batch_queries);
+                move(batch_result.begin(), batch_result.end(), result.begin() + batch_start);
+            }
+            );
+
+    return result;
+}
+
+std::vector<SearchResult> ProcessQueries(
+        const SearchServer& search_server,
+        const std::vector<std::string>& queries,
+        const SearchOptions& options) {
+
+    std::vector<SearchResult> result(queries.size());
+    transform(
+            execution::par,
+            queries.begin(), queries.end(),
+            result.begin(),
+            [&search_server, &options](const std::string& query) { return search_server.FindTopDocuments(query, options); }
+            );
+
+    return result;
+}
+
 std::vector<Document> ProcessQueriesJoined(
         const SearchServer& search_server,
         const std::vector<std::string>& queries) {
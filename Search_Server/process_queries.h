@@ -6,6 +6,18 @@ std::vector<std::vector<Document>> ProcessQueries(
         const SearchServer& search_server,
         const std::vector<std::string>& queries);
 
+// Same result as ProcessQueries. Queries are split into batches searched in parallel, in a batch
+// every posting list is traversed once for all queries with its word
+std::vector<std::vector<Document>> ProcessQueriesBatched(
+        const SearchServer& search_server,
+        const std::vector<std::string>& queries);
+
+// Every query gets its own budget, a deadline in options is shared by the whole batch
+std::vector<SearchResult> ProcessQueries(
+        const SearchServer& search_server,
+        const std::vector<std::string>& queries,
+        const SearchOptions& options);
+
 vector<Document> ProcessQueriesJoined(
         const SearchServer& search_server,
         const std::vector<std::string>& queries);
\ No newline at end of file
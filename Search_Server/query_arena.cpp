@@ -0,0 +1,68 @@
+#include "query_arena.h"
+
+#include <algorithm>
+
+namespace {
+
+constexpr size_t kInitialThreadBufferSize = 16 * 1024;
+// A larger query takes the rest from the heap and frees it when it ends, so one huge query does not pin
+// its memory on every thread for the life of the process
+constexpr size_t kMaxThreadBufferSize = 4 * 1024 * 1024;
+
+struct ThreadBuffer {
+    std::vector<std::byte> data;
+    bool is_used = false;
+};
+
+thread_local ThreadBuffer thread_buffer;
+
+} // namespace
+
+QueryArena::QueryArena() {
+    if (thread_buffer.is_used) {
+        resource_.emplace(&overflow_resource_);
+        return;
+    }
+    thread_buffer.is_used = true;
+    if (thread_buffer.data.empty()) {
+        thread_buffer.data.resize(kInitialThreadBufferSize);
+    }
+    thread_buffer_ = &thread_buffer.data;
+    resource_.emplace(thread_buffer_->data(), thread_buffer_->size(), &overflow_resource_);
+}
+
+QueryArena::~QueryArena() {
+    resource_.reset();
+    if (thread_buffer_ == nullptr) {
+        return;
+    }
+    // The next query of the same size fits into the buffer, unless it is above the cap
+    if (const size_t overflow_bytes = overflow_resource_.GetAllocatedBytes();
+        overflow_bytes > 0 && thread_buffer_->size() < kMaxThreadBufferSize) {
+        const size_t new_size = std::max(2 * thread_buffer_->size(), thread_buffer_->size() + overflow_bytes);
+        thread_buffer_->resize(std::min(new_size, kMaxThreadBufferSize));
+        thread_buffer_->shrink_to_fit();
+    }
+    thread_buffer.is_used = false;
+}
+
+[[nodiscard]] std::pmr::memory_resource* QueryArena::GetResource() {
+    return &*resource_;
+}
+
+[[nodiscard]] size_t QueryArena::OverflowResource::GetAllocatedBytes() const {
+    return allocated_bytes_;
+}
+
+void* QueryArena::OverflowResource::do_allocate(size_t bytes, size_t alignment) {
+    allocated_bytes_ += bytes;
+    return std::pmr::new_delete_resource()->allocate(bytes, alignment);
+}
+
+void QueryArena::OverflowResource::do_deallocate(void* pointer, size_t bytes, size_t alignment) {
+    std::pmr::new_delete_resource()->deallocate(pointer, bytes, alignment);
+}
+
+[[nodiscard]] bool QueryArena::OverflowResource::do_is_equal(const std::pmr::memory_resource& other) const noexcept {
+    return this == &other;
+}
@@ -0,0 +1,45 @@
+#pragma once
+
+#include <cstddef>
+#include <memory_resource>
+#include <optional>
+#include <vector>
+
+// Memory for the temporary containers of one query, freed all at once when the arena is destroyed.
+// The first arena on a thread takes a buffer kept by the thread, which grows to the largest query
+// seen there up to a cap, so in steady state a query does not touch the global heap. An arena created while
+// another one is alive on the same thread (TBB may run a task of another query inside a parallel
+// algorithm) gets memory from the heap. An arena must be used by one thread only
+class QueryArena {
+public:
+    QueryArena();
+
+    QueryArena(const QueryArena&) = delete;
+    QueryArena& operator=(const QueryArena&) = delete;
+
+    ~QueryArena();
+
+    [[nodiscard]] std::pmr::memory_resource* GetResource();
+
+private:
+    // Heap memory requested by the arena after its buffer ran out
+    class OverflowResource : public std::pmr::memory_resource {
+    public:
+        [[nodiscard]] size_t GetAllocatedBytes() const;
+
+    private:
+        void* do_allocate(size_t bytes, size_t alignment) override;
+
+        void do_deallocate(void* pointer, size_t bytes, size_t alignment) override;
+
+        [[nodiscard]] bool do_is_equal(const std::pmr::memory_resource& other) const noexcept override;
+
+    private:
+        size_t allocated_bytes_ = 0;
+    };
+
+private:
+    std::vector<std::byte>* thread_buffer_ = nullptr;
+    OverflowResource overflow_resource_;
+    std::optional<std::pmr::monotonic_buffer_resource> resource_;
+};
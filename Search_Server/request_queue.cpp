@@ -1,5 +1,26 @@
 #include "request_queue.h"
 
+#include <execution>
+#include <thread>
+
+namespace {
+
+int GetLatencyBucket(std::chrono::microseconds latency, int bucket_count) {
+    int bucket = 0;
+    for (auto value = latency.count(); value > 0 && bucket + 1 < bucket_count; value >>= 1) {
+        ++bucket;
+    }
+    return bucket;
+}
+
+} // namespace
+
+RequestQueue::RequestQueue(const SearchServer& search_server)
+    : search_server_(search_server)
+    , buckets_(std::make_unique<MinuteBucket[]>(kMinutesInDay))
+{
+}
+
 std::vector<Document> RequestQueue::AddFindRequest(std::string_view  raw_query, DocumentStatus status) {
     return AddFindRequest(raw_query,
                           [status](int /*document_id*/, DocumentStatus document_status, int /*rating*/)
@@ -10,6 +31,110 @@ std::vector<Document> RequestQueue::AddFindRequest(std::string_view  raw_query)
     return AddFindRequest(raw_query, DocumentStatus::ACTUAL);
 }
 
+std::vector<std::vector<Document>> RequestQueue::ProcessQueries(const std::vector<std::string>& queries) {
+    std::vector<std::vector<Document>> result(queries.size());
+    transform(
+            std::execution::par,
+            queries.begin(), queries.end(),
+            result.begin(),
+            [this](const std::string& query) { return AddFindRequest(query); }
+            );
+    return result;
+}
+
 [[nodiscard]] int RequestQueue::GetNoResultRequests() const {
-    return count_if(requests_.begin(), requests_.end(), [](QueryResult element) { return element.response_counter == 0; });
+    ExpireBuckets(GetMinute(Clock::now()));
+    return totals_.no_result.load(std::memory_order_relaxed);
+}
+
+[[nodiscard]] int RequestQueue::GetTotalRequests() const {
+    ExpireBuckets(GetMinute(Clock::now()));
+    return totals_.total.load(std::memory_order_relaxed);
+}
+
+[[nodiscard]] std::chrono::microseconds RequestQueue::GetLatencyPercentile(double percentile) const {
+    ExpireBuckets(GetMinute(Clock::now()));
+    std::array<int, kLatencyBucketCount> latency;
+    int total = 0;
+    for (int i = 0; i < kLatencyBucketCount; ++i) {
+        latency[i] = totals_.latency[i].load(std::memory_order_relaxed);
+        total += latency[i];
+    }
+
+    const double rank = total * std::clamp(percentile, 0.0, 100.0) / 100.0;
+    int seen = 0;
+    for (int i = 0; i < kLatencyBucketCount; ++i) {
+        seen += latency[i];
+        if (seen > 0 && seen >= rank) {
+            return std::chrono::microseconds(int64_t{1} << i);
+        }
+    }
+    return std::chrono::microseconds(0);
+}
+
+[[nodiscard]] int64_t RequestQueue::GetMinute(Clock::time_point time) const {
+    return std::chrono::duration_cast<std::chrono::minutes>(time - start_time_).count();
+}
+
+void RequestQueue::RecordRequest(Clock::time_point start_time, Clock::time_point end_time, bool no_result) {
+    const int64_t minute = GetMinute(end_time);
+    ExpireBuckets(minute);
+
+    MinuteBucket& bucket = buckets_[minute % kMinutesInDay];
+    for (int64_t bucket_minute = bucket.minute.load(); bucket_minute != minute; bucket_minute = bucket.minute.load()) {
+        if (bucket_minute > minute) {
+            // The request took longer than a day and its minute is gone already
+            return;
+        }
+        if (bucket_minute == kResettingMinute) {
+            std::this_thread::yield();
+            continue;
+        }
+        // Whoever claims the bucket moves it to the new minute, others wait for the reset
+        if (bucket.minute.compare_exchange_strong(bucket_minute, kResettingMinute)) {
+            SubtractFromTotals(bucket.counters);
+            bucket.minute.store(minute);
+            break;
+        }
+    }
+
+    const auto latency = std::chrono::duration_cast<std::chrono::microseconds>(end_time - start_time);
+    const int latency_bucket = GetLatencyBucket(latency, kLatencyBucketCount);
+    for (Counters* counters : {&bucket.counters, &totals_}) {
+        counters->total.fetch_add(1, std::memory_order_relaxed);
+        if (no_result) {
+            counters->no_result.fetch_add(1, std::memory_order_relaxed);
+        }
+        counters->latency[latency_bucket].fetch_add(1, std::memory_order_relaxed);
+    }
+}
+
+void RequestQueue::ExpireBuckets(int64_t current_minute) const {
+    const int64_t expire_through = current_minute - kMinutesInDay;
+    int64_t expired_through = expired_through_.load();
+    while (expired_through < expire_through) {
+        if (expired_through_.compare_exchange_weak(expired_through, expire_through)) {
+            // Only the last day of the range can still be in the ring
+            for (int64_t minute = std::max(expired_through + 1, expire_through - kMinutesInDay + 1); minute <= expire_through; ++minute) {
+                ExpireBucket(buckets_[minute % kMinutesInDay], minute);
+            }
+            return;
+        }
+    }
+}
+
+void RequestQueue::ExpireBucket(MinuteBucket& bucket, int64_t minute) const {
+    int64_t bucket_minute = minute;
+    if (bucket.minute.compare_exchange_strong(bucket_minute, kResettingMinute)) {
+        SubtractFromTotals(bucket.counters);
+        bucket.minute.store(kEmptyMinute);
+    }
+}
+
+void RequestQueue::SubtractFromTotals(Counters& counters) const {
+    totals_.total.fetch_sub(counters.total.exchange(0), std::memory_order_relaxed);
+    totals_.no_result.fetch_sub(counters.no_result.exchange(0), std::memory_order_relaxed);
+    for (int i = 0; i < kLatencyBucketCount; ++i) {
+        totals_.latency[i].fetch_sub(counters.latency[i].exchange(0), std::memory_order_relaxed);
+    }
 }
@@ -1,56 +1,84 @@
 #pragma once
 
 
-#include <deque>
+#include <array>
+#include <atomic>
+#include <chrono>
+#include <memory>
+#include <string>
 #include <vector>
 
 #include "document.h"
 #include "search_server.h"
 
+// Statistics of the requests of the last day. Requests are counted in a ring of per-minute buckets
+// of atomic counters, so the queue can be shared by concurrent callers
 class RequestQueue {
 public:
-    explicit RequestQueue(const SearchServer& search_server) 
-        : search_server_(search_server)
-    {
-    }
+    using Clock = std::chrono::steady_clock;
+
+    explicit RequestQueue(const SearchServer& search_server);
 
     // сделаем "обёртки" для всех методов поиска, чтобы сохранять результаты для нашей статистики
     template <typename DocumentPredicate>
     std::vector<Document> AddFindRequest(std::string_view raw_query, DocumentPredicate document_predicate) {
+        const auto start_time = Clock::now();
         auto result = search_server_.FindTopDocuments(raw_query, document_predicate);
-        QueryResult element = { 1, static_cast<int>(result.size()) };
-        if (requests_.empty()) {
-            requests_.push_back(element);
-        }
-
-        if (requests_.size() != kMinutesInDay) {
-            element.time = ++requests_.back().time;
-            requests_.push_back(element);
-        } else {
-            if (requests_.back().time == kMinutesInDay) {
-                element.time = 1;
-            } else {
-                element.time = ++requests_.back().time;
-            }
-            requests_.push_back(element);
-            requests_.pop_front();
-        }
-
+        RecordRequest(start_time, Clock::now(), result.empty());
         return result;
     }
 
     std::vector<Document> AddFindRequest(std::string_view  raw_query, DocumentStatus status);
     std::vector<Document> AddFindRequest(std::string_view  raw_query);
 
+    // ProcessQueries with every query recorded in the statistics
+    std::vector<std::vector<Document>> ProcessQueries(const std::vector<std::string>& queries);
+
     [[nodiscard]] int GetNoResultRequests() const;
+
+    [[nodiscard]] int GetTotalRequests() const;
+
+    // Upper bound of the latency bucket holding the given percentile (0 - 100) of the requests
+    [[nodiscard]] std::chrono::microseconds GetLatencyPercentile(double percentile) const;
+
+private:
+    static const int kMinutesInDay = 1440;
+    // Bucket i holds latencies in [2^(i - 1), 2^i) microseconds
+    static const int kLatencyBucketCount = 32;
+    static const int64_t kEmptyMinute = -1;
+    static const int64_t kResettingMinute = -2;
+
 private:
-    struct QueryResult {
-        int time = 0;
-        int response_counter = 0;
+    struct Counters {
+        std::atomic<int> total{0};
+        std::atomic<int> no_result{0};
+        std::array<std::atomic<int>, kLatencyBucketCount> latency{};
     };
+
+    struct MinuteBucket {
+        std::atomic<int64_t> minute{kEmptyMinute};
+        Counters counters;
+    };
+
 private:
-    static const int kMinutesInDay = 1440;
+    [[nodiscard]] int64_t GetMinute(Clock::time_point time) const;
+
+    void RecordRequest(Clock::time_point start_time, Clock::time_point end_time, bool no_result);
+
+    // Subtracts buckets older than a day from the totals
+    void ExpireBuckets(int64_t current_minute) const;
+
+    // Empties the bucket unless it was already moved on from the given minute
+    void ExpireBucket(MinuteBucket& bucket, int64_t minute) const;
+
+    // Resets bucket counters, removing them from the totals
+    void SubtractFromTotals(Counters& counters) const;
+
 private:
     const SearchServer& search_server_;
-    std::deque<QueryResult> requests_;
-};
\ No newline at end of file
+    const Clock::time_point start_time_ = Clock::now();
+    // Buckets and totals are updated from const queries when old minutes expire
+    std::unique_ptr<MinuteBucket[]> buckets_;
+    mutable Counters totals_;
+    mutable std::atomic<int64_t> expired_through_{-1};
+};
@@ -0,0 +1,5 @@
+#include "search_cursor.h"
+
+SearchCursor MakeSearchCursor(const Document& document) {
+    return {document.relevance, document.rating, document.id};
+}
@@ -0,0 +1,12 @@
+#pragma once
+
+#include "document.h"
+
+// Search-after token: the next page holds documents ranked strictly below this one
+struct SearchCursor {
+    double relevance = 0.0;
+    int rating = 0;
+    int id = 0;
+};
+
+SearchCursor MakeSearchCursor(const Document& document);
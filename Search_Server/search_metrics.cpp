@@ -0,0 +1,156 @@
+#include "search_metrics.h"
+
+#include <algorithm>
+
+using namespace std::string_literals;
+
+namespace {
+
+const char* const kStageNames[kSearchStageCount] = {"parse", "posting_fetch", "scoring", "minus_filter", "intersection", "top_k"};
+const char* const kCounterNames[kSearchCounterCount] = {"postings_scanned", "documents_matched"};
+
+} // namespace
+
+size_t LatencyHistogram::GetBucketIndex(uint64_t value) {
+    if (value < kSubBucketCount) {
+        return static_cast<size_t>(value);
+    }
+    int highest_bit = 0;
+    for (uint64_t rest = value; rest > 1; rest >>= 1) {
+        ++highest_bit;
+    }
+    const int shift = highest_bit - kSubBucketBits;
+    const uint64_t sub_bucket = (value >> shift) & (kSubBucketCount - 1);
+    return static_cast<size_t>((shift + 1) * kSubBucketCount + sub_bucket);
+}
+
+uint64_t LatencyHistogram::GetBucketValue(size_t index) {
+    if (index < kSubBucketCount) {
+        return index;
+    }
+    const int shift = static_cast<int>(index / kSubBucketCount) - 1;
+    const uint64_t sub_bucket = index % kSubBucketCount;
+    return ((kSubBucketCount + sub_bucket) << shift) + ((uint64_t{1} << shift) - 1);
+}
+
+void LatencyHistogram::Add(size_t index, uint64_t count) {
+    counts_[index] += count;
+    total_count_ += count;
+}
+
+void LatencyHistogram::Merge(const LatencyHistogram& other) {
+    for (size_t i = 0; i < kBucketCount; ++i) {
+        counts_[i] += other.counts_[i];
+    }
+    total_count_ += other.total_count_;
+}
+
+[[nodiscard]] uint64_t LatencyHistogram::GetCount() const {
+    return total_count_;
+}
+
+[[nodiscard]] uint64_t LatencyHistogram::GetValueAtPercentile(double percentile) const {
+    if (total_count_ == 0) {
+        return 0;
+    }
+    const double rank = std::clamp(percentile, 0.0, 100.0) / 100.0 * static_cast<double>(total_count_);
+    uint64_t seen = 0;
+    for (size_t i = 0; i < kBucketCount; ++i) {
+        seen += counts_[i];
+        if (seen > 0 && static_cast<double>(seen) >= rank) {
+            return GetBucketValue(i);
+        }
+    }
+    return GetBucketValue(kBucketCount - 1);
+}
+
+void ThreadMetrics::RecordStage(SearchStage stage, std::chrono::steady_clock::duration duration) {
+    const auto nanoseconds = std::chrono::duration_cast<std::chrono::nanoseconds>(duration).count();
+    const size_t index = LatencyHistogram::GetBucketIndex(static_cast<uint64_t>(std::max<int64_t>(nanoseconds, 0)));
+    Increment(stages_[static_cast<size_t>(stage)][index], 1);
+}
+
+void ThreadMetrics::AddCount(SearchCounter counter, uint64_t value) {
+    Increment(counters_[static_cast<size_t>(counter)], value);
+}
+
+void ThreadMetrics::AddToSnapshot(MetricsSnapshot& snapshot) const {
+    for (size_t stage = 0; stage < kSearchStageCount; ++stage) {
+        for (size_t i = 0; i < LatencyHistogram::kBucketCount; ++i) {
+            const uint64_t count = stages_[stage][i].load(std::memory_order_relaxed);
+            if (count != 0) {
+                snapshot.stages[stage].Add(i, count);
+            }
+        }
+    }
+    for (size_t counter = 0; counter < kSearchCounterCount; ++counter) {
+        snapshot.counters[counter] += counters_[counter].load(std::memory_order_relaxed);
+    }
+}
+
+void ThreadMetrics::Reset() {
+    for (auto& stage : stages_) {
+        for (auto& count : stage) {
+            count.exchange(0, std::memory_order_relaxed);
+        }
+    }
+    for (auto& counter : counters_) {
+        counter.exchange(0, std::memory_order_relaxed);
+    }
+}
+
+ThreadMetrics& SearchMetrics::GetThreadMetrics() {
+    thread_local const std::shared_ptr<ThreadMetrics> thread_metrics = [] {
+        auto metrics = std::make_shared<ThreadMetrics>();
+        std::lock_guard<std::mutex> guard(GetMutex());
+        GetRegistry().push_back(metrics);
+        return metrics;
+    }();
+    return *thread_metrics;
+}
+
+MetricsSnapshot SearchMetrics::TakeSnapshot() {
+    MetricsSnapshot snapshot;
+    std::lock_guard<std::mutex> guard(GetMutex());
+    for (const auto& metrics : GetRegistry()) {
+        metrics->AddToSnapshot(snapshot);
+    }
+    return snapshot;
+}
+
+void SearchMetrics::Reset() {
+    std::lock_guard<std::mutex> guard(GetMutex());
+    for (const auto& metrics : GetRegistry()) {
+        metrics->Reset();
+    }
+}
+
+std::mutex& SearchMetrics::GetMutex() {
+    static std::mutex mutex;
+    return mutex;
+}
+
+std::vector<std::shared_ptr<ThreadMetrics>>& SearchMetrics::GetRegistry() {
+    // Metrics outlive their threads, so the numbers of finished threads stay in snapshots
+    static std::vector<std::shared_ptr<ThreadMetrics>> registry;
+    return registry;
+}
+
+void PrintMetrics(std::ostream& out, const MetricsSnapshot& snapshot) {
+    out << "{\"stages\": {"s;
+    for (size_t stage = 0; stage < kSearchStageCount; ++stage) {
+        const LatencyHistogram& histogram = snapshot.stages[stage];
+        out << (stage == 0 ? ""s : ", "s) << '"' << kStageNames[stage] << "\": {"s
+            << "\"count\": "s << histogram.GetCount()
+            << ", \"p50_ns\": "s << histogram.GetValueAtPercentile(50)
+            << ", \"p90_ns\": "s << histogram.GetValueAtPercentile(90)
+            << ", \"p99_ns\": "s << histogram.GetValueAtPercentile(99)
+            << ", \"p999_ns\": "s << histogram.GetValueAtPercentile(99.9)
+            << ", \"max_ns\": "s << histogram.GetValueAtPercentile(100) << '}';
+    }
+    out << "}, \"counters\": {"s;
+    for (size_t counter = 0; counter < kSearchCounterCount; ++counter) {
+        out << (counter == 0 ? ""s : ", "s) << '"' << kCounterNames[counter] << "\": "s << snapshot.counters[counter];
+    }
+    out << "}}"s;
+}
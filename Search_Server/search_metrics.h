@@ -0,0 +1,128 @@
+#pragma once
+
+#include <array>
+#include <atomic>
+#include <chrono>
+#include <cstdint>
+#include <iostream>
+#include <memory>
+#include <mutex>
+#include <vector>
+
+// Search path instrumentation. Compiled in only with SEARCH_SERVER_METRICS defined,
+// otherwise SEARCH_METRICS_* macros expand to nothing
+#define SEARCH_METRICS_CONCAT_INTERNAL(X, Y) X##Y
+#define SEARCH_METRICS_CONCAT(X, Y) SEARCH_METRICS_CONCAT_INTERNAL(X, Y)
+
+#ifdef SEARCH_SERVER_METRICS
+#define SEARCH_METRICS_STAGE(stage) StageTimer SEARCH_METRICS_CONCAT(stageTimer, __LINE__)(stage)
+#define SEARCH_METRICS_COUNT(counter, value) SearchMetrics::GetThreadMetrics().AddCount(counter, value)
+#else
+#define SEARCH_METRICS_STAGE(stage)
+#define SEARCH_METRICS_COUNT(counter, value)
+#endif
+
+enum class SearchStage {
+    PARSE,
+    POSTING_FETCH,
+    SCORING,
+    MINUS_FILTER,
+    INTERSECTION,
+    TOP_K,
+};
+
+enum class SearchCounter {
+    POSTINGS_SCANNED,
+    DOCUMENTS_MATCHED,
+};
+
+constexpr size_t kSearchStageCount = 6;
+constexpr size_t kSearchCounterCount = 2;
+
+// HDR-style histogram of nanoseconds: every power of two range is split into
+// kSubBucketCount linear sub-buckets, so values are kept with about 6% precision
+class LatencyHistogram {
+public:
+    static constexpr int kSubBucketBits = 4;
+    static constexpr uint64_t kSubBucketCount = uint64_t{1} << kSubBucketBits;
+    static constexpr size_t kBucketCount = (64 - kSubBucketBits + 1) * kSubBucketCount;
+
+    static size_t GetBucketIndex(uint64_t value);
+
+    // Largest value that falls into the bucket
+    static uint64_t GetBucketValue(size_t index);
+
+    void Add(size_t index, uint64_t count);
+
+    void Merge(const LatencyHistogram& other);
+
+    [[nodiscard]] uint64_t GetCount() const;
+
+    [[nodiscard]] uint64_t GetValueAtPercentile(double percentile) const;
+
+private:
+    std::array<uint64_t, kBucketCount> counts_ = {};
+    uint64_t total_count_ = 0;
+};
+
+struct MetricsSnapshot {
+    std::array<LatencyHistogram, kSearchStageCount> stages;
+    std::array<uint64_t, kSearchCounterCount> counters = {};
+};
+
+// Metrics written by a single thread and read by snapshots from any thread
+class ThreadMetrics {
+public:
+    void RecordStage(SearchStage stage, std::chrono::steady_clock::duration duration);
+
+    void AddCount(SearchCounter counter, uint64_t value);
+
+    void AddToSnapshot(MetricsSnapshot& snapshot) const;
+
+    void Reset();
+
+private:
+    // The owning thread adds while Reset may zero the value from another thread, so the update is
+    // a single read-modify-write: a load + store pair could write back a count from before the reset
+    static void Increment(std::atomic<uint64_t>& value, uint64_t delta) {
+        value.fetch_add(delta, std::memory_order_relaxed);
+    }
+
+private:
+    std::array<std::array<std::atomic<uint64_t>, LatencyHistogram::kBucketCount>, kSearchStageCount> stages_ = {};
+    std::array<std::atomic<uint64_t>, kSearchCounterCount> counters_ = {};
+};
+
+class SearchMetrics {
+public:
+    // Metrics of the calling thread, registered on first use
+    static ThreadMetrics& GetThreadMetrics();
+
+    // Sum over all threads that have recorded anything
+    static MetricsSnapshot TakeSnapshot();
+
+    static void Reset();
+
+private:
+    static std::mutex& GetMutex();
+
+    static std::vector<std::shared_ptr<ThreadMetrics>>& GetRegistry();
+};
+
+class StageTimer {
+public:
+    explicit StageTimer(SearchStage stage)
+        : stage_(stage) {
+    }
+
+    ~StageTimer() {
+        SearchMetrics::GetThreadMetrics().RecordStage(stage_, std::chrono::steady_clock::now() - start_time_);
+    }
+
+private:
+    const SearchStage stage_;
+    const std::chrono::steady_clock::time_point start_time_ = std::chrono::steady_clock::now();
+};
+
+// Snapshot as a JSON object: count and p50/p90/p99/p999/max in nanoseconds per stage, and counters
+void PrintMetrics(std::ostream& out, const MetricsSnapshot& snapshot);
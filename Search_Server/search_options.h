@@ -0,0 +1,42 @@
+#pragma once
+
+#include <chrono>
+#include <cstddef>
+#include <limits>
+#include <optional>
+#include <vector>
+
+#include "document.h"
+
+enum class QueryMode {
+    // Documents with any of the plus-words, or with all of the words marked with +
+    ANY,
+    // Documents with all of the plus-words
+    ALL,
+};
+
+// Per-query settings. A search that runs out of the budget stops and returns the best documents found so far
+struct SearchOptions {
+    using Clock = std::chrono::steady_clock;
+
+    QueryMode mode = QueryMode::ANY;
+
+    std::optional<Clock::time_point> deadline;
+    // Counted from the start of the query, combined with deadline if both are set
+    std::optional<Clock::duration> timeout;
+    size_t max_postings = std::numeric_limits<size_t>::max();
+
+    [[nodiscard]] std::optional<Clock::time_point> GetDeadline(Clock::time_point start_time) const {
+        if (!timeout) {
+            return deadline;
+        }
+        const Clock::time_point timeout_deadline = start_time + *timeout;
+        return deadline ? std::min(*deadline, timeout_deadline) : timeout_deadline;
+    }
+};
+
+struct SearchResult {
+    std::vector<Document> documents;
+    // The budget was exhausted, so some matching documents may have been skipped
+    bool is_partial = false;
+};
@@ -0,0 +1,95 @@
+#pragma once
+
+#include <iterator>
+#include <optional>
+#include <string>
+#include <vector>
+
+#include "paginator.h"
+#include "search_cursor.h"
+#include "search_server.h"
+
+// Pages of search results fetched one at a time: every page is a bounded top
+// of documents ranked after the last document of the previous page
+template <typename DocumentPredicate>
+class SearchPaginator {
+public:
+    class PageIterator {
+    public:
+        using iterator_category = std::input_iterator_tag;
+        using value_type = IteratorRange<std::vector<Document>::const_iterator>;
+        using difference_type = std::ptrdiff_t;
+        using pointer = const value_type*;
+        using reference = value_type;
+
+        PageIterator() = default;
+
+        explicit PageIterator(const SearchPaginator* paginator)
+            : paginator_(paginator)
+            , page_(paginator->FetchPage(std::nullopt)) {
+        }
+
+        value_type operator*() const {
+            return {page_.begin(), page_.end()};
+        }
+
+        PageIterator& operator++() {
+            if (page_.size() < paginator_->page_size_) {
+                page_.clear();
+            } else {
+                page_ = paginator_->FetchPage(MakeSearchCursor(page_.back()));
+            }
+            return *this;
+        }
+
+        // Only comparison with the end iterator is meaningful
+        bool operator==(const PageIterator& other) const {
+            return page_.empty() && other.page_.empty();
+        }
+
+        bool operator!=(const PageIterator& other) const {
+            return !(*this == other);
+        }
+
+    private:
+        const SearchPaginator* paginator_ = nullptr;
+        std::vector<Document> page_;
+    };
+
+    SearchPaginator(const SearchServer& search_server, std::string_view raw_query, size_t page_size,
+                    DocumentPredicate document_predicate)
+        : search_server_(search_server)
+        , raw_query_(raw_query)
+        , page_size_(page_size)
+        , document_predicate_(document_predicate) {
+    }
+
+    PageIterator begin() const {
+        return PageIterator(this);
+    }
+
+    PageIterator end() const {
+        return {};
+    }
+
+    std::vector<Document> FetchPage(const std::optional<SearchCursor>& cursor) const {
+        return search_server_.FindTopDocumentsAfter(raw_query_, cursor, page_size_, document_predicate_);
+    }
+
+private:
+    const SearchServer& search_server_;
+    std::string raw_query_;
+    size_t page_size_;
+    DocumentPredicate document_predicate_;
+};
+
+template <typename DocumentPredicate>
+auto PaginateSearch(const SearchServer& search_server, std::string_view raw_query, size_t page_size,
+                    DocumentPredicate document_predicate) {
+    return SearchPaginator<DocumentPredicate>(search_server, raw_query, page_size, document_predicate);
+}
+
+inline auto PaginateSearch(const SearchServer& search_server, std::string_view raw_query, size_t page_size) {
+    return PaginateSearch(search_server, raw_query, page_size,
+                          [](int /*id*/, DocumentStatus document_status, int /*rating*/) { return document_status == DocumentStatus::ACTUAL; });
+}
@@ -0,0 +1,173 @@
+#include "search_scheduler.h"
+
+#include <algorithm>
+#include <iterator>
+#include <limits>
+#include <string_view>
+#include <utility>
+
+namespace {
+
+// Only queries without a budget can share posting traversal in FindTopDocumentsBatch
+bool IsBatchable(const SearchOptions& options) {
+    return options.mode == QueryMode::ANY && !options.deadline && !options.timeout
+            && options.max_postings == std::numeric_limits<size_t>::max();
+}
+
+} // namespace
+
+SchedulerOverloaded::SchedulerOverloaded()
+        : std::runtime_error("Search queue is full") {
+}
+
+SearchScheduler::SearchScheduler(const SearchServer& search_server, const SchedulerOptions& options)
+        : search_server_(search_server)
+        , options_(options) {
+    if (options_.max_batch_size == 0 || options_.queue_capacity == 0) {
+        throw std::invalid_argument("Batch size and queue capacity must be positive");
+    }
+    const size_t worker_count = options_.worker_count != 0
+            ? options_.worker_count
+            : std::max<size_t>(std::thread::hardware_concurrency(), 1);
+    workers_.reserve(worker_count);
+    for (size_t i = 0; i < worker_count; ++i) {
+        workers_.emplace_back([this] { RunWorker(); });
+    }
+}
+
+SearchScheduler::~SearchScheduler() {
+    {
+        std::lock_guard lock(mutex_);
+        stopping_ = true;
+    }
+    cv_.notify_all();
+    for (std::thread& worker : workers_) {
+        worker.join();
+    }
+}
+
+[[nodiscard]] std::future<SearchResult> SearchScheduler::SearchAsync(std::string raw_query, const SearchOptions& options) {
+    Request request{std::move(raw_query), options, {}, {}, {}};
+    std::future<SearchResult> result = request.promise.get_future();
+    Submit(std::move(request));
+    return result;
+}
+
+void SearchScheduler::SearchAsync(std::string raw_query, const SearchOptions& options, Callback callback) {
+    Submit({std::move(raw_query), options, {}, {}, std::move(callback)});
+}
+
+[[nodiscard]] SchedulerStatistics SearchScheduler::GetStatistics() const {
+    return {accepted_.load(), rejected_.load(), expired_.load(), batches_.load()};
+}
+
+void SearchScheduler::Submit(Request request) {
+    request.arrival_time = SearchOptions::Clock::now();
+    request.options.deadline = request.options.GetDeadline(request.arrival_time);
+    request.options.timeout.reset();
+    {
+        std::lock_guard lock(mutex_);
+        if (!stopping_ && queue_.size() < options_.queue_capacity) {
+            queue_.push_back(std::move(request));
+            ++accepted_;
+            cv_.notify_one();
+            return;
+        }
+    }
+    ++rejected_;
+    Fail(request, std::make_exception_ptr(SchedulerOverloaded()));
+}
+
+void SearchScheduler::RunWorker() {
+    std::vector<Request> batch;
+    while (true) {
+        {
+            std::unique_lock lock(mutex_);
+            cv_.wait(lock, [this] { return !queue_.empty() || stopping_; });
+            if (queue_.empty()) {
+                return;
+            }
+            // Wait for more requests unless the batch is already full
+            const auto batch_deadline = queue_.front().arrival_time + options_.batch_window;
+            cv_.wait_until(lock, batch_deadline, [this] { return queue_.size() >= options_.max_batch_size || stopping_; });
+            // Another worker could take the requests meanwhile
+            if (queue_.empty()) {
+                continue;
+            }
+            const size_t batch_size = std::min(queue_.size(), options_.max_batch_size);
+            move(queue_.begin(), queue_.begin() + batch_size, back_inserter(batch));
+            queue_.erase(queue_.begin(), queue_.begin() + batch_size);
+            if (!queue_.empty()) {
+                cv_.notify_one();
+            }
+        }
+        ProcessBatch(batch);
+        batch.clear();
+    }
+}
+
+void SearchScheduler::ProcessBatch(std::vector<Request>& batch) {
+    ++batches_;
+    const auto now = SearchOptions::Clock::now();
+    std::vector<Request*> batch_requests;
+    std::vector<std::string_view> batch_queries;
+    for (Request& request : batch) {
+        if (request.options.deadline && *request.options.deadline <= now) {
+            ++expired_;
+            Complete(request, {{}, true});
+        } else if (IsBatchable(request.options)) {
+            batch_requests.push_back(&request);
+            batch_queries.push_back(request.raw_query);
+        } else {
+            SearchResult result;
+            try {
+                result = search_server_.FindTopDocuments(request.raw_query, request.options);
+            } catch (...) {
+                Fail(request, std::current_exception());
+                continue;
+            }
+            Complete(request, std::move(result));
+        }
+    }
+    if (batch_requests.empty()) {
+        return;
+    }
+
+    std::vector<std::vector<Document>> results;
+    try {
+        results = search_server_.FindTopDocumentsBatch(batch_queries);
+    } catch (...) {
+        results.clear();
+    }
+    if (!results.empty()) {
+        for (size_t i = 0; i < batch_requests.size(); ++i) {
+            Complete(*batch_requests[i], {std::move(results[i]), false});
+        }
+        return;
+    }
+    // An invalid query fails the whole batch, so the queries are searched one by one to fail only it
+    for (Request* request : batch_requests) {
+        std::vector<Document> documents;
+        try {
+            documents = search_server_.FindTopDocuments(request->raw_query);
+        } catch (...) {
+            Fail(*request, std::current_exception());
+            continue;
+        }
+        Complete(*request, {std::move(documents), false});
+    }
+}
+
+void SearchScheduler::Complete(Request& request, SearchResult result) {
+    request.promise.set_value(std::move(result));
+    if (request.callback) {
+        request.callback(request.promise.get_future());
+    }
+}
+
+void SearchScheduler::Fail(Request& request, std::exception_ptr exception) {
+    request.promise.set_exception(exception);
+    if (request.callback) {
+        request.callback(request.promise.get_future());
+    }
+}
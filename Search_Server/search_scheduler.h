@@ -0,0 +1,102 @@
+#pragma once
+
+#include <atomic>
+#include <chrono>
+#include <condition_variable>
+#include <cstddef>
+#include <deque>
+#include <functional>
+#include <future>
+#include <mutex>
+#include <stdexcept>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include "search_options.h"
+#include "search_server.h"
+
+struct SchedulerOptions {
+    // Requests arriving within the window after the first waiting one are searched as one batch
+    std::chrono::microseconds batch_window{200};
+    size_t max_batch_size = 256;
+    // Requests beyond the capacity are rejected at once instead of waiting
+    size_t queue_capacity = 4096;
+    // Zero means one worker per hardware thread
+    size_t worker_count = 0;
+};
+
+struct SchedulerStatistics {
+    uint64_t accepted = 0;
+    // Rejected because the queue was full
+    uint64_t rejected = 0;
+    // Dropped with an empty partial result because the deadline passed while waiting in the queue
+    uint64_t expired = 0;
+    uint64_t batches = 0;
+};
+
+// Thrown through the future of a request rejected by a full queue
+class SchedulerOverloaded : public std::runtime_error {
+public:
+    SchedulerOverloaded();
+};
+
+// Non-blocking search over a server that is not modified while the scheduler exists. Concurrent requests
+// are collected into micro-batches searched with FindTopDocumentsBatch by a small pool of workers.
+// A timeout in options is counted from the submission of the request, so the waiting time counts too
+class SearchScheduler {
+public:
+    using Callback = std::function<void(std::future<SearchResult>)>;
+
+    explicit SearchScheduler(const SearchServer& search_server, const SchedulerOptions& options = {});
+
+    SearchScheduler(const SearchScheduler&) = delete;
+    SearchScheduler& operator=(const SearchScheduler&) = delete;
+
+    // Searches the requests still in the queue, then stops the workers
+    ~SearchScheduler();
+
+    [[nodiscard]] std::future<SearchResult> SearchAsync(std::string raw_query, const SearchOptions& options = {});
+
+    // The callback gets a ready future on a worker thread, or on the calling one if the request is rejected,
+    // so the caller does not wait at all. The callback must not throw
+    void SearchAsync(std::string raw_query, const SearchOptions& options, Callback callback);
+
+    [[nodiscard]] SchedulerStatistics GetStatistics() const;
+
+private:
+    struct Request {
+        std::string raw_query;
+        SearchOptions options;
+        SearchOptions::Clock::time_point arrival_time;
+        std::promise<SearchResult> promise;
+        Callback callback;
+    };
+
+private:
+    void Submit(Request request);
+
+    void RunWorker();
+
+    void ProcessBatch(std::vector<Request>& batch);
+
+    void Complete(Request& request, SearchResult result);
+
+    void Fail(Request& request, std::exception_ptr exception);
+
+private:
+    const SearchServer& search_server_;
+    const SchedulerOptions options_;
+
+    std::mutex mutex_;
+    std::condition_variable cv_;
+    std::deque<Request> queue_;
+    bool stopping_ = false;
+
+    std::atomic<uint64_t> accepted_{0};
+    std::atomic<uint64_t> rejected_{0};
+    std::atomic<uint64_t> expired_{0};
+    std::atomic<uint64_t> batches_{0};
+
+    std::vector<std::thread> workers_;
+};
@@ -1,5 +1,8 @@
 #include "search_server.h"
 
+#include <limits>
+#include <tuple>
+
 SearchServer::SearchServer(const std::string& stop_words_text)
         : SearchServer(SplitIntoWords(stop_words_text))  // Invoke delegating constructor
 // from string container
@@ -21,47 +24,227 @@ SearchServer::SearchServer(std::string_view stop_words_text)
 }
 
 [[nodiscard]] size_t SearchServer::GetDocumentCount() const {
-    return documents_.size();
+    return document_id_to_ordinal_.size();
 }
 
 [[nodiscard]] const map<std::string_view, double>& SearchServer::GetWordFrequencies(int document_id) const {
     static map<std::string_view, double> result = {};
     result.clear();
+    const auto ordinal_it = document_id_to_ordinal_.find(document_id);
+    if (ordinal_it == document_id_to_ordinal_.end()) {
+        return result;
+    }
     for (const auto& [word, freqs] : word_to_document_freqs_) {
-        if (freqs.count(document_id) != 0) {
-            result.insert({word, freqs.at(document_id)});
+        if (const auto it = freqs.find(ordinal_it->second); it != freqs.end()) {
+            result.insert({word, it->second});
         }
     }
     return result;
 }
 
+[[nodiscard]] DocumentStatus SearchServer::GetDocumentStatus(int document_id) const {
+    return GetDocumentData(document_id).status;
+}
+
+[[nodiscard]] int SearchServer::GetDocumentRating(int document_id) const {
+    return GetDocumentData(document_id).rating;
+}
+
 void SearchServer::AddDocument(int document_id, std::string_view document, DocumentStatus status, const vector<int> &ratings) {
-    if (document_id < 0 || (documents_.count(document_id) > 0)) {
+    if (document_id < 0 || (document_id_to_ordinal_.count(document_id) > 0)) {
         throw invalid_argument("Not valid document id");
     }
     const vector<std::string_view> words = SplitIntoWordsNoStop(document);
 
+    const int ordinal = free_ordinals_.empty() ? static_cast<int>(documents_.size()) : free_ordinals_.back();
     const double inv_word_count = 1.0 / static_cast<double>(words.size());
     for (std::string_view word : words) {
         auto it = all_words_.insert(string(word));
-        word_to_document_freqs_[*it.first][document_id] += inv_word_count;
+        auto [freqs_it, inserted] = word_to_document_freqs_.try_emplace(*it.first);
+        if (inserted) {
+            AddToVocabularyFilter(freqs_it->first);
+            if (fuzzy_index_) {
+                fuzzy_index_->AddWord(freqs_it->first);
+            }
+        }
+        freqs_it->second[ordinal] += inv_word_count;
+    }
+    if (ordinal == static_cast<int>(documents_.size())) {
+        documents_.push_back({document_id, ComputeAverageRating(ratings), status});
+    } else {
+        documents_[ordinal] = {document_id, ComputeAverageRating(ratings), status};
+        free_ordinals_.pop_back();
+    }
+    document_id_to_ordinal_.emplace(document_id, ordinal);
+    document_ids_.insert(upper_bound(document_ids_.begin(), document_ids_.end(), document_id), document_id);
+    if (document_store_) {
+        document_store_->AddDocument(document_id, document);
+    }
+    impact_index_.reset();
+}
+
+void SearchServer::EnableFuzzyMatching(int max_edit_distance) {
+    if (max_edit_distance < 1) {
+        throw invalid_argument("Max edit distance must be positive");
+    }
+    fuzzy_index_.emplace(max_edit_distance);
+    for (const auto& [word, _] : word_to_document_freqs_) {
+        fuzzy_index_->AddWord(word);
+    }
+}
+
+void SearchServer::DisableFuzzyMatching() {
+    fuzzy_index_.reset();
+}
+
+void SearchServer::EnableDocumentStore() {
+    if (!document_store_) {
+        document_store_.emplace();
+    }
+}
+
+[[nodiscard]] std::string SearchServer::GetDocumentText(int document_id) const {
+    if (!document_store_) {
+        throw out_of_range("Document store is disabled");
+    }
+    return document_store_->GetDocumentText(document_id);
+}
+
+void SearchServer::ForEachDocumentText(const std::function<void(int, std::string_view)>& handler) const {
+    if (!document_store_) {
+        throw out_of_range("Document store is disabled");
+    }
+    document_store_->ForEachDocument(handler);
+}
+
+void SearchServer::BuildImpactIndex() {
+    double max_impact = 0.0;
+    for (const auto& [word, document_freqs] : word_to_document_freqs_) {
+        if (document_freqs.empty()) {
+            continue;
+        }
+        const double inverse_document_freq = ComputeWordInverseDocumentFreq(word, document_freqs.size());
+        for (const auto [_, term_freq] : document_freqs) {
+            max_impact = std::max(max_impact, term_freq * inverse_document_freq);
+        }
+    }
+
+    impact_index_.emplace(max_impact);
+    std::vector<std::pair<int, double>> document_impacts;
+    for (const auto& [word, document_freqs] : word_to_document_freqs_) {
+        if (document_freqs.empty()) {
+            continue;
+        }
+        const double inverse_document_freq = ComputeWordInverseDocumentFreq(word, document_freqs.size());
+        document_impacts.clear();
+        for (const auto [ordinal, term_freq] : document_freqs) {
+            document_impacts.emplace_back(documents_[ordinal].id, term_freq * inverse_document_freq);
+        }
+        impact_index_->AddWord(word, document_impacts);
+    }
+}
+
+void SearchServer::ReorderDocuments() {
+    // MinHash of a document: the least hash of its words for each of kReorderSignatureSize seeds.
+    // Documents with many common words are likely to have equal leading components. Words found in
+    // a large part of the corpus are skipped, they would put unrelated documents together
+    using Signature = std::array<uint64_t, kReorderSignatureSize>;
+    Signature empty_signature;
+    empty_signature.fill(std::numeric_limits<uint64_t>::max());
+    std::vector<Signature> signatures(documents_.size(), empty_signature);
+    for (const auto& [word, document_freqs] : word_to_document_freqs_) {
+        if (document_freqs.size() * kReorderMaxWordShare > GetDocumentCount()) {
+            continue;
+        }
+        Signature word_hashes;
+        for (size_t i = 0; i < kReorderSignatureSize; ++i) {
+            word_hashes[i] = HashWord(word, i);
+        }
+        for (const auto [ordinal, _] : document_freqs) {
+            for (size_t i = 0; i < kReorderSignatureSize; ++i) {
+                signatures[ordinal][i] = std::min(signatures[ordinal][i], word_hashes[i]);
+            }
+        }
+    }
+
+    std::vector<int> new_to_old_ordinal;
+    new_to_old_ordinal.reserve(document_id_to_ordinal_.size());
+    for (const auto [_, ordinal] : document_id_to_ordinal_) {
+        new_to_old_ordinal.push_back(ordinal);
+    }
+    sort(new_to_old_ordinal.begin(), new_to_old_ordinal.end(), [this, &signatures](int lhs, int rhs) {
+        return std::tie(signatures[lhs], documents_[lhs].id) < std::tie(signatures[rhs], documents_[rhs].id);
+    });
+
+    std::vector<int> old_to_new_ordinal(documents_.size(), -1);
+    std::vector<DocumentData> documents;
+    documents.reserve(new_to_old_ordinal.size());
+    for (const int old_ordinal : new_to_old_ordinal) {
+        old_to_new_ordinal[old_ordinal] = static_cast<int>(documents.size());
+        document_id_to_ordinal_[documents_[old_ordinal].id] = static_cast<int>(documents.size());
+        documents.push_back(documents_[old_ordinal]);
+    }
+    documents_ = std::move(documents);
+    free_ordinals_.clear();
+
+    // Postings are rebuilt word by word, so nodes of one list are also allocated close to each other
+    std::vector<std::pair<int, double>> postings;
+    for (auto& [_, document_freqs] : word_to_document_freqs_) {
+        postings.clear();
+        for (const auto [ordinal, term_freq] : document_freqs) {
+            postings.emplace_back(old_to_new_ordinal[ordinal], term_freq);
+        }
+        sort(postings.begin(), postings.end());
+        document_freqs = std::map<int, double>(postings.begin(), postings.end());
     }
-    documents_.emplace(document_id, DocumentData{ComputeAverageRating(ratings), status});
-    document_ids_.push_back(document_id);
+}
+
+[[nodiscard]] IndexStatistics SearchServer::GetIndexStatistics() const {
+    const auto get_varint_size = [](uint32_t value) {
+        size_t size = 1;
+        for (; value >= 0x80; value >>= 7) {
+            ++size;
+        }
+        return size;
+    };
+
+    IndexStatistics statistics;
+    statistics.document_count = GetDocumentCount();
+    for (const auto& [_, document_freqs] : word_to_document_freqs_) {
+        if (document_freqs.empty()) {
+            continue;
+        }
+        ++statistics.word_count;
+        statistics.posting_count += document_freqs.size();
+        int previous_ordinal = 0;
+        for (const auto [ordinal, _] : document_freqs) {
+            statistics.encoded_posting_bytes += get_varint_size(static_cast<uint32_t>(ordinal - previous_ordinal));
+            previous_ordinal = ordinal;
+        }
+    }
+    return statistics;
 }
 
 void SearchServer::RemoveDocument(int document_id) {
-    documents_.erase(document_id);
+    const auto ordinal_it = document_id_to_ordinal_.find(document_id);
+    if (ordinal_it == document_id_to_ordinal_.end()) {
+        return;
+    }
+    const int ordinal = ordinal_it->second;
+    document_id_to_ordinal_.erase(ordinal_it);
+    free_ordinals_.push_back(ordinal);
+    impact_index_.reset();
+    if (document_store_) {
+        document_store_->RemoveDocument(document_id);
+    }
 
     auto id_to_delete = lower_bound(document_ids_.begin(), document_ids_.end(), document_id);
-    if (*id_to_delete == document_id) {
+    if (id_to_delete != document_ids_.end() && *id_to_delete == document_id) {
         document_ids_.erase(id_to_delete);
     }
 
     for (auto& [_, freqs] : word_to_document_freqs_) {
-        if (freqs.count(document_id) != 0) {
-            freqs.erase(document_id);
-        }
+        freqs.erase(ordinal);
     }
 }
 
@@ -70,23 +253,61 @@ void SearchServer::RemoveDocument(std::execution::sequenced_policy, int document
 }
 
 void SearchServer::RemoveDocument(std::execution::parallel_policy, int document_id) {
-    documents_.erase(document_id);
+    const auto ordinal_it = document_id_to_ordinal_.find(document_id);
+    if (ordinal_it == document_id_to_ordinal_.end()) {
+        return;
+    }
+    const int ordinal = ordinal_it->second;
+    document_id_to_ordinal_.erase(ordinal_it);
+    free_ordinals_.push_back(ordinal);
+    impact_index_.reset();
+    if (document_store_) {
+        document_store_->RemoveDocument(document_id);
+    }
 
     auto id_to_delete = lower_bound(document_ids_.begin(), document_ids_.end(), document_id);
-    if (*id_to_delete == document_id) {
+    if (id_to_delete != document_ids_.end() && *id_to_delete == document_id) {
         document_ids_.erase(id_to_delete);
     }
 
     std::for_each(
             std::execution::par,
             word_to_document_freqs_.begin(), word_to_document_freqs_.end(),
-            [&document_id](auto& element) {
-                if (element.second.count(document_id) != 0) {
-                    element.second.erase(document_id);
-                }
+            [ordinal](auto& element) {
+                element.second.erase(ordinal);
             });
 }
 
+[[nodiscard]] std::vector<std::vector<Document>> SearchServer::FindTopDocumentsBatch(const std::vector<std::string_view>& raw_queries) const {
+    return FindTopDocumentsBatch(raw_queries, [](int /*id*/, DocumentStatus document_status, int /*rating*/) { return document_status == DocumentStatus::ACTUAL; });
+}
+
+[[nodiscard]] SearchResult SearchServer::FindTopDocuments(std::string_view raw_query, const SearchOptions& options) const {
+    return FindTopDocuments(raw_query, options, [](int /*id*/, DocumentStatus document_status, int /*rating*/) { return document_status == DocumentStatus::ACTUAL; });
+}
+
+[[nodiscard]] std::vector<Document> SearchServer::FindTopDocumentsByImpact(std::string_view raw_query) const {
+    return FindTopDocumentsByImpact(raw_query, [](int /*id*/, DocumentStatus document_status, int /*rating*/) { return document_status == DocumentStatus::ACTUAL; });
+}
+
+[[nodiscard]] std::vector<Document> SearchServer::FindTopDocuments(std::string_view raw_query, const CorpusStatistics& statistics,
+                                                                   DocumentStatus status) const {
+    return FindTopDocuments(raw_query, statistics, [status](int /*id*/, DocumentStatus document_status, int /*rating*/) { return document_status == status; });
+}
+
+[[nodiscard]] CorpusStatistics SearchServer::GetQueryStatistics(std::string_view raw_query) const {
+    const auto query = ParseQuery(raw_query);
+
+    CorpusStatistics statistics;
+    statistics.document_count = GetDocumentCount();
+    for (const auto [word, _] : query.plus_words) {
+        if (const auto* document_freqs = FindWordFreqs(word); document_freqs != nullptr && !document_freqs->empty()) {
+            statistics.document_freqs.emplace(word, document_freqs->size());
+        }
+    }
+    return statistics;
+}
+
 [[nodiscard]] std::vector<Document> SearchServer::FindTopDocuments(std::string_view raw_query, DocumentStatus status) const {
     return FindTopDocuments(raw_query, [status](int /*id*/, DocumentStatus document_status, int /*rating*/) { return document_status == status; });
 }
@@ -99,6 +320,15 @@ void SearchServer::RemoveDocument(std::execution::parallel_policy, int document_
     return FindTopDocuments(execution::par, raw_query, [status](int /*id*/, DocumentStatus document_status, int /*rating*/) { return document_status == status; });
 }
 
+void SearchServer::FindTopDocuments(std::string_view raw_query, DocumentStatus status, std::vector<Document>& top_documents) const {
+    FindTopDocuments(raw_query, [status](int /*id*/, DocumentStatus document_status, int /*rating*/) { return document_status == status; },
+                     top_documents);
+}
+
+void SearchServer::FindTopDocuments(std::string_view raw_query, std::vector<Document>& top_documents) const {
+    FindTopDocuments(raw_query, DocumentStatus::ACTUAL, top_documents);
+}
+
 [[nodiscard]] std::vector<Document> SearchServer::FindTopDocuments(std::string_view raw_query) const {
     return FindTopDocuments(raw_query, DocumentStatus::ACTUAL);
 }
@@ -111,28 +341,45 @@ void SearchServer::RemoveDocument(std::execution::parallel_policy, int document_
     return FindTopDocuments(execution::par, raw_query, DocumentStatus::ACTUAL);
 }
 
+[[nodiscard]] std::vector<DocumentSnippet> SearchServer::FindTopDocumentsWithSnippets(std::string_view raw_query, size_t window_size) const {
+    return FindTopDocumentsWithSnippets(raw_query, window_size,
+                                        [](int /*id*/, DocumentStatus document_status, int /*rating*/) { return document_status == DocumentStatus::ACTUAL; });
+}
+
+[[nodiscard]] std::pair<std::vector<Document>, SearchAggregation> SearchServer::FindTopDocumentsWithAggregation(std::string_view raw_query,
+                                                                                                                const std::vector<int>& rating_bounds) const {
+    return FindTopDocumentsWithAggregation(raw_query, rating_bounds,
+                                           [](int /*id*/, DocumentStatus document_status, int /*rating*/) { return document_status == DocumentStatus::ACTUAL; });
+}
+
+[[nodiscard]] std::vector<Document> SearchServer::FindTopDocumentsAfter(std::string_view raw_query, const std::optional<SearchCursor>& cursor,
+                                                                        size_t page_size) const {
+    return FindTopDocumentsAfter(raw_query, cursor, page_size,
+                                 [](int /*id*/, DocumentStatus document_status, int /*rating*/) { return document_status == DocumentStatus::ACTUAL; });
+}
+
 [[nodiscard]] std::tuple<std::vector<std::string_view>, DocumentStatus> SearchServer::MatchDocument(std::string_view raw_query, int document_id) const {
     const auto query = ParseQuery(raw_query);
+    const int ordinal = document_id_to_ordinal_.at(document_id);
 
     std::vector<std::string_view> matched_words;
-    for (std::string_view word : query.plus_words) {
-        if (word_to_document_freqs_.count(word) == 0) {
-            continue;
-        }
-        if (word_to_document_freqs_.at(word).count(document_id)) {
-            matched_words.push_back(word);
+    for (const auto [word, _] : query.plus_words) {
+        const auto* entry = FindWordEntry(word);
+        if (entry != nullptr && entry->second.count(ordinal) != 0) {
+            // The query views raw_query, which may not outlive the call
+            matched_words.push_back(entry->first);
+        } else if (query.required_words.count(word) != 0) {
+            return {std::vector<std::string_view>{}, documents_[ordinal].status};
         }
     }
     for (std::string_view word : query.minus_words) {
-        if (word_to_document_freqs_.count(word) == 0) {
-            continue;
-        }
-        if (word_to_document_freqs_.at(word).count(document_id)) {
+        const auto* document_freqs = FindWordFreqs(word);
+        if (document_freqs != nullptr && document_freqs->count(ordinal) != 0) {
             matched_words.clear();
             break;
         }
     }
-    return {matched_words, documents_.at(document_id).status};
+    return {matched_words, documents_[ordinal].status};
 }
 
 [[nodiscard]] std::tuple<std::vector<std::string_view>, DocumentStatus> SearchServer::MatchDocument(std::execution::sequenced_policy,
@@ -145,39 +392,43 @@ void SearchServer::RemoveDocument(std::execution::parallel_policy, int document_
                                                                                                std::string_view raw_query,
                                                                                                int document_id) const {
     const auto query = ParseQuery(raw_query);
+    const int ordinal = document_id_to_ordinal_.at(document_id);
 
     mutex m;
     mutex x;
 
     std::vector<std::string_view> matched_words;
+    bool is_required_word_missing = false;
     for_each(
             std::execution::par,
             query.plus_words.begin(), query.plus_words.end(),
-            [document_id, &matched_words, this, &m](std::string_view word) {
+            [ordinal, &matched_words, &is_required_word_missing, &query, this, &m](const auto& plus_word) {
+                const std::string_view word = plus_word.first;
                 lock_guard<mutex> guard(m);
-                if (word_to_document_freqs_.count(word) == 0) {
-                    return;
-                }
-                if (word_to_document_freqs_.at(word).count(document_id)) {
-                    matched_words.push_back(word);
+                const auto* entry = FindWordEntry(word);
+                if (entry != nullptr && entry->second.count(ordinal) != 0) {
+                    matched_words.push_back(entry->first);
+                } else if (query.required_words.count(word) != 0) {
+                    is_required_word_missing = true;
                 }
             });
+    if (is_required_word_missing) {
+        return {std::vector<std::string_view>{}, documents_[ordinal].status};
+    }
 
     for_each(
             std::execution::par,
             query.minus_words.begin(), query.minus_words.end(),
-            [document_id, &matched_words, this, &x](std::string_view word) {
+            [ordinal, &matched_words, this, &x](std::string_view word) {
                 lock_guard<mutex> guard(x);
-                if (word_to_document_freqs_.count(word) == 0) {
-                    return;
-                }
-                if (word_to_document_freqs_.at(word).count(document_id)) {
+                const auto* document_freqs = FindWordFreqs(word);
+                if (document_freqs != nullptr && document_freqs->count(ordinal) != 0) {
                     matched_words.clear();
                     return;
                 }
             });
 
-    return {matched_words, documents_.at(document_id).status};
+    return {matched_words, documents_[ordinal].status};
 }
 
 // private =========================================================
@@ -188,6 +439,9 @@ bool SearchServer::IsValidWord(std::string_view word) {
 }
 
 int SearchServer::ComputeAverageRating(const vector<int> &ratings) {
+    if (ratings.empty()) {
+        return 0;
+    }
     int rating_sum = 0;
     for (const int rating : ratings) {
         rating_sum += rating;
@@ -195,8 +449,37 @@ int SearchServer::ComputeAverageRating(const vector<int> &ratings) {
     return rating_sum / static_cast<int>(ratings.size());
 }
 
+[[nodiscard]] const SearchServer::DocumentData& SearchServer::GetDocumentData(int document_id) const {
+    return documents_[document_id_to_ordinal_.at(document_id)];
+}
+
 [[nodiscard]] bool SearchServer::IsStopWord(std::string_view word) const {
-    return stop_words_.count(word) > 0;
+    return stop_words_.Contains(word);
+}
+
+[[nodiscard]] const std::map<int, double>* SearchServer::FindWordFreqs(std::string_view word) const {
+    const auto* entry = FindWordEntry(word);
+    return entry != nullptr ? &entry->second : nullptr;
+}
+
+[[nodiscard]] const std::pair<const std::string_view, std::map<int, double>>* SearchServer::FindWordEntry(std::string_view word) const {
+    if (!vocabulary_filter_.MayContain(word)) {
+        return nullptr;
+    }
+    const auto it = word_to_document_freqs_.find(word);
+    return it != word_to_document_freqs_.end() ? &*it : nullptr;
+}
+
+void SearchServer::AddToVocabularyFilter(std::string_view word) {
+    if (vocabulary_filter_.GetSize() >= vocabulary_filter_.GetCapacity()) {
+        // word is already in word_to_document_freqs_
+        vocabulary_filter_ = BloomFilter(std::max<size_t>(2 * vocabulary_filter_.GetCapacity(), kInitialVocabularyFilterCapacity));
+        for (const auto& [known_word, _] : word_to_document_freqs_) {
+            vocabulary_filter_.Add(known_word);
+        }
+        return;
+    }
+    vocabulary_filter_.Add(word);
 }
 
 [[nodiscard]] std::vector<std::string_view> SearchServer::SplitIntoWordsNoStop(std::string_view text) const { // =================== ??????????????????????????
@@ -214,42 +497,205 @@ int SearchServer::ComputeAverageRating(const vector<int> &ratings) {
 
 [[nodiscard]] SearchServer::QueryWord SearchServer::ParseQueryWord(std::string_view text) const {
     bool is_minus = false;
+    bool is_required = false;
     // Word shouldn't be empty
     if (text[0] == '-') {
         is_minus = true;
         text = text.substr(1);
+    } else if (text[0] == '+') {
+        is_required = true;
+        text = text.substr(1);
     }
 
     // Check validation
-    if (text.empty() || text[0] == '-' || text.back() == '-' || !IsValidWord(text)) {
+    if (text.empty() || text[0] == '-' || text[0] == '+' || text.back() == '-' || !IsValidWord(text)) {
         throw invalid_argument("Not valid word");
     }
 
-    return { text, is_minus, IsStopWord(text)};
+    return { text, is_minus, IsStopWord(text), is_required};
 }
 
-[[nodiscard]] SearchServer::Query SearchServer::ParseQuery(std::string_view text) const {
-    Query query;
-    for (std::string_view word : SplitIntoWords(text)) {
+[[nodiscard]] SearchServer::Query SearchServer::ParseQuery(std::string_view text, std::pmr::memory_resource* resource, QueryMode mode) const {
+    SEARCH_METRICS_STAGE(SearchStage::PARSE);
+    Query query(resource);
+    for (std::string_view word : SplitIntoWords(text, resource)) {
         const QueryWord query_word = ParseQueryWord(word);
         if (!query_word.is_stop) {
             if (query_word.is_minus) {
                 query.minus_words.insert(query_word.data);
             }
             else {
-                query.plus_words.insert(query_word.data);
+                query.plus_words.emplace(query_word.data, 1.0);
+                if (query_word.is_required || mode == QueryMode::ALL) {
+                    query.required_words.insert(query_word.data);
+                }
             }
         }
     }
+
+    if (fuzzy_index_) {
+        std::pmr::map<std::string_view, double> expanded_words(resource);
+        for (const auto [word, _] : query.plus_words) {
+            const int max_distance = word.size() < kMinTwoEditWordLength ? 1 : fuzzy_index_->GetMaxEditDistance();
+            auto similar_words = fuzzy_index_->FindSimilarWords(word, max_distance);
+            // pair<DISTANCE, minus DOCUMENT_FREQ>, so the nearest and then the most frequent words go first
+            const auto rank = [this](const std::pair<std::string_view, int>& similar_word) {
+                const auto* document_freqs = FindWordFreqs(similar_word.first);
+                return std::pair(similar_word.second, -static_cast<long>(document_freqs != nullptr ? document_freqs->size() : 0));
+            };
+            similar_words.erase(remove_if(similar_words.begin(), similar_words.end(),
+                                          [word](const auto& similar_word) { return similar_word.first == word; }),
+                                similar_words.end());
+            const size_t expansion_count = std::min(similar_words.size(), kMaxFuzzyExpansions);
+            partial_sort(similar_words.begin(), similar_words.begin() + expansion_count, similar_words.end(),
+                         [&rank](const auto& lhs, const auto& rhs) {
+                             return std::tuple(rank(lhs), lhs.first) < std::tuple(rank(rhs), rhs.first);
+                         });
+            for (size_t i = 0; i < expansion_count; ++i) {
+                const auto& [similar_word, distance] = similar_words[i];
+                double& weight = expanded_words[similar_word];
+                weight = std::max(weight, std::pow(kFuzzyWordPenalty, distance));
+            }
+        }
+        for (const auto [word, weight] : expanded_words) {
+            double& query_weight = query.plus_words[word];
+            query_weight = std::max(query_weight, weight);
+        }
+    }
     return query;
 }
 
-[[nodiscard]] double SearchServer::ComputeWordInverseDocumentFreq(std::string_view word) const {
-    return log(static_cast<double>(GetDocumentCount()) * 1.0 / static_cast<double>(word_to_document_freqs_.at(word).size()));
+void SearchServer::IntersectWithPostings(std::pmr::vector<int>& ordinals, const std::map<int, double>& document_freqs) {
+    auto kept_end = ordinals.begin();
+    if (ordinals.size() * kTreeSearchRatio < document_freqs.size()) {
+        // The postings are much longer: a tree search per ordinal skips most of them
+        for (const int ordinal : ordinals) {
+            if (document_freqs.count(ordinal) != 0) {
+                *kept_end++ = ordinal;
+            }
+        }
+        SEARCH_METRICS_COUNT(SearchCounter::POSTINGS_SCANNED, ordinals.size());
+    } else {
+        auto posting = document_freqs.begin();
+        for (const int ordinal : ordinals) {
+            while (posting != document_freqs.end() && posting->first < ordinal) {
+                ++posting;
+            }
+            if (posting == document_freqs.end()) {
+                break;
+            }
+            if (posting->first == ordinal) {
+                *kept_end++ = ordinal;
+            }
+        }
+        SEARCH_METRICS_COUNT(SearchCounter::POSTINGS_SCANNED, document_freqs.size());
+    }
+    ordinals.erase(kept_end, ordinals.end());
+}
+
+[[nodiscard]] double SearchServer::ComputeWordInverseDocumentFreq(std::string_view word, size_t document_freq,
+                                                                  const CorpusStatistics* statistics) const {
+    if (statistics != nullptr) {
+        if (const auto it = statistics->document_freqs.find(word); it != statistics->document_freqs.end()) {
+            return log(static_cast<double>(statistics->document_count) * 1.0 / static_cast<double>(it->second));
+        }
+    }
+    return log(static_cast<double>(GetDocumentCount()) * 1.0 / static_cast<double>(document_freq));
+}
+
+[[nodiscard]] bool SearchServer::IsMoreRelevant(const Document& lhs, const Document& rhs) {
+    if (abs(lhs.relevance - rhs.relevance) < kRelevanceAccuracy) {
+        if (lhs.rating == rhs.rating) {
+            return lhs.id < rhs.id;
+        }
+        return lhs.rating > rhs.rating;
+    } else {
+        return lhs.relevance > rhs.relevance;
+    }
+}
+
+void SearchServer::PushTopDocument(std::vector<Document>& top_documents, const Document& document, size_t limit) const {
+    const auto is_more_relevant = [this](const Document& lhs, const Document& rhs) { return IsMoreRelevant(lhs, rhs); };
+    if (top_documents.size() == limit) {
+        if (limit == 0 || !IsMoreRelevant(document, top_documents.front())) {
+            return;
+        }
+        pop_heap(top_documents.begin(), top_documents.end(), is_more_relevant);
+        top_documents.pop_back();
+    }
+    top_documents.push_back(document);
+    push_heap(top_documents.begin(), top_documents.end(), is_more_relevant);
+}
+
+void SearchServer::SortTopDocuments(std::vector<Document>& top_documents) const {
+    sort_heap(top_documents.begin(), top_documents.end(), [this](const Document& lhs, const Document& rhs) { return IsMoreRelevant(lhs, rhs); });
+}
+
+[[nodiscard]] std::string SearchServer::BuildSnippet(const std::map<std::string_view, double>& word_scores, int document_id,
+                                                     size_t window_size) const {
+    if (!document_store_ || !document_store_->HasDocument(document_id) || window_size == 0) {
+        return {};
+    }
+    const std::string text = document_store_->GetDocumentText(document_id);
+    std::vector<std::string_view> words = SplitIntoWords(text);
+    // Runs of spaces in the stored text give empty words, which would take places in the window
+    words.erase(remove(words.begin(), words.end(), std::string_view()), words.end());
+
+    std::vector<double> scores(words.size(), 0.0);
+    for (size_t i = 0; i < words.size(); ++i) {
+        if (const auto it = word_scores.find(words[i]); it != word_scores.end()) {
+            scores[i] = it->second;
+        }
+    }
+
+    // Sliding window, a word repeated inside the window is scored once
+    std::map<std::string_view, int> window_counts;
+    double window_score = 0.0;
+    double best_score = -1.0;
+    size_t best_begin = 0;
+    for (size_t i = 0; i < words.size(); ++i) {
+        if (scores[i] > 0 && window_counts[words[i]]++ == 0) {
+            window_score += scores[i];
+        }
+        if (i >= window_size) {
+            const size_t removed = i - window_size;
+            if (scores[removed] > 0 && --window_counts[words[removed]] == 0) {
+                window_score -= scores[removed];
+            }
+        }
+        if (window_score > best_score + kRelevanceAccuracy) {
+            best_score = window_score;
+            best_begin = i + 1 > window_size ? i + 1 - window_size : 0;
+        }
+    }
+
+    std::string snippet;
+    const size_t best_end = std::min(words.size(), best_begin + window_size);
+    for (size_t i = best_begin; i < best_end; ++i) {
+        if (!snippet.empty()) {
+            snippet.push_back(' ');
+        }
+        // Document texts are arbitrary, so only the highlighting stays markup
+        if (scores[i] > 0) {
+            snippet += "<b>"s;
+            AppendEscapedHtml(snippet, words[i]);
+            snippet += "</b>"s;
+        } else {
+            AppendEscapedHtml(snippet, words[i]);
+        }
+    }
+    return snippet;
 }
 
 // func out of search_server ===============================================================================
 
+void CorpusStatistics::Merge(const CorpusStatistics& other) {
+    document_count += other.document_count;
+    for (const auto& [word, document_freq] : other.document_freqs) {
+        document_freqs[word] += document_freq;
+    }
+}
+
 void PrintDocument(const Document& document) {
     std::cout << "{ "s
               << "document_id = "s << document.id << ", "s
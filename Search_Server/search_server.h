@@ -1,16 +1,30 @@
 #pragma once
 
 #include <map>
+#include <array>
+#include <memory_resource>
 #include <cmath>
 #include <numeric>
 #include <algorithm>
 #include <stdexcept>
 #include <execution>
+#include <functional>
+#include <optional>
+#include <unordered_map>
+#include <vector>
 
 #include "document.h"
+#include "document_store.h"
 #include "string_processing.h"
 #include "read_input_functions.h"
 #include "concurrent_map.h"
+#include "fuzzy_index.h"
+#include "impact_index.h"
+#include "query_arena.h"
+#include "search_metrics.h"
+#include "search_cursor.h"
+#include "search_options.h"
+#include "word_filter.h"
 
 using namespace std::string_literals;
 using namespace std;
@@ -24,6 +38,40 @@ enum class DocumentStatus {
     REMOVED,
 };
 
+// Facets of the whole matched set of a query, computed before top documents are cut off
+struct SearchAggregation {
+    int total_hits = 0;
+    std::array<int, 4> status_counts = {}; // indexed by DocumentStatus
+    // Bucket i holds ratings in [rating_bounds[i - 1], rating_bounds[i]), the last one is open-ended
+    std::vector<int> rating_histogram;
+};
+
+// Arguments of SearchServer::AddDocument, the text is not owned
+struct DocumentRecord {
+    int id = 0;
+    std::string_view text;
+    DocumentStatus status = DocumentStatus::ACTUAL;
+    std::vector<int> ratings;
+};
+
+// Corpus size and document frequencies of query words. Statistics of several servers
+// can be merged to score every one of them as a part of a single corpus
+struct CorpusStatistics {
+    size_t document_count = 0;
+    std::map<std::string, size_t, std::less<>> document_freqs;
+
+    void Merge(const CorpusStatistics& other);
+};
+
+// Size of the inverted index. encoded_posting_bytes is the size postings would take with document ordinals
+// delta- and varint-encoded, it shows how well documents sharing words are clustered
+struct IndexStatistics {
+    size_t document_count = 0;
+    size_t word_count = 0;
+    size_t posting_count = 0;
+    size_t encoded_posting_bytes = 0;
+};
+
 class SearchServer {
 public:
     template <typename StringContainer>
@@ -32,10 +80,12 @@ public:
             throw std::invalid_argument("Some of stop words are invalid"s);
         }
 
+        std::vector<std::string_view> stop_word_views;
         for (std::string_view word : stop_words) {
             auto it = all_words_.insert(string(word));
-            stop_words_.insert(*it.first);
+            stop_word_views.push_back(*it.first);
         }
+        stop_words_ = PerfectHashSet(std::move(stop_word_views));
     }
 
     explicit SearchServer(const std::string& stop_words_text);
@@ -50,8 +100,38 @@ public:
 
     [[nodiscard]] const map<std::string_view, double>& GetWordFrequencies(int document_id) const;
 
+    [[nodiscard]] DocumentStatus GetDocumentStatus(int document_id) const;
+
+    [[nodiscard]] int GetDocumentRating(int document_id) const;
+
     void AddDocument(int document_id, std::string_view document, DocumentStatus status, const vector<int>& ratings);
 
+    // Query plus-words are expanded to dictionary words within max_edit_distance, scored with a penalty.
+    // Words shorter than kMinTwoEditWordLength allow one edit only, and every word gets at most
+    // kMaxFuzzyExpansions expansions: the nearest ones, the most frequent first
+    void EnableFuzzyMatching(int max_edit_distance = 2);
+
+    void DisableFuzzyMatching();
+
+    // Keeps original texts of documents added from now on, see GetDocumentText
+    void EnableDocumentStore();
+
+    [[nodiscard]] std::string GetDocumentText(int document_id) const;
+
+    // Calls handler with the id and the text of every stored document, cheaper than GetDocumentText for each
+    void ForEachDocumentText(const std::function<void(int, std::string_view)>& handler) const;
+
+    // Builds the impact-ordered index used by FindTopDocumentsByImpact. Adding or removing
+    // a document changes IDF of every word, so it drops the index until the next build
+    void BuildImpactIndex();
+
+    // Renumbers document ordinals so that documents with common words get close ones: documents are sorted by
+    // MinHash signatures of their words. External ids and search results do not change. Must not run
+    // concurrently with searches
+    void ReorderDocuments();
+
+    [[nodiscard]] IndexStatistics GetIndexStatistics() const;
+
     void RemoveDocument(int document_id);
 
     void RemoveDocument(std::execution::sequenced_policy, int document_id);
@@ -60,24 +140,38 @@ public:
 
     template <typename DocumentPredicate>
     std::vector<Document> FindTopDocuments(std::string_view raw_query, DocumentPredicate document_predicate) const {
-        const auto query = ParseQuery(raw_query);
+        std::vector<Document> top_documents;
+        FindTopDocuments(raw_query, document_predicate, top_documents);
+        return top_documents;
+    }
 
-        auto matched_documents = FindAllDocuments(query, document_predicate);
+    // Replaces the contents of top_documents, so a caller reusing the vector does not allocate memory
+    template <typename DocumentPredicate>
+    void FindTopDocuments(std::string_view raw_query, DocumentPredicate document_predicate, std::vector<Document>& top_documents) const {
+        QueryArena arena;
+        FindTopDocumentsByQuery(ParseQuery(raw_query, arena.GetResource()), document_predicate, nullptr, top_documents);
+    }
 
-        sort(matched_documents.begin(), matched_documents.end(), [&](const Document& lhs, const Document& rhs) {
-            if (abs(lhs.relevance - rhs.relevance) < kRelevanceAccuracy) {
-                return lhs.rating > rhs.rating;
-            } else {
-                return lhs.relevance > rhs.relevance;
-            }
-        });
-        if (matched_documents.size() > MAX_RESULT_DOCUMENT_COUNT) {
-            matched_documents.resize(MAX_RESULT_DOCUMENT_COUNT);
-        }
+    void FindTopDocuments(std::string_view raw_query, DocumentStatus status, std::vector<Document>& top_documents) const;
 
-        return matched_documents;
+    void FindTopDocuments(std::string_view raw_query, std::vector<Document>& top_documents) const;
+
+    // Relevance is computed with IDF of statistics instead of the server own numbers
+    template <typename DocumentPredicate>
+    std::vector<Document> FindTopDocuments(std::string_view raw_query, const CorpusStatistics& statistics,
+                                           DocumentPredicate document_predicate) const {
+        QueryArena arena;
+        std::vector<Document> top_documents;
+        FindTopDocumentsByQuery(ParseQuery(raw_query, arena.GetResource()), document_predicate, &statistics, top_documents);
+        return top_documents;
     }
 
+    [[nodiscard]] std::vector<Document> FindTopDocuments(std::string_view raw_query, const CorpusStatistics& statistics,
+                                                         DocumentStatus status) const;
+
+    // Statistics of the query words found in this server
+    [[nodiscard]] CorpusStatistics GetQueryStatistics(std::string_view raw_query) const;
+
     template <typename DocumentPredicate>
     std::vector<Document> FindTopDocuments(execution::sequenced_policy, std::string_view raw_query, DocumentPredicate document_predicate) const {
         return FindTopDocuments(raw_query, document_predicate);
@@ -88,12 +182,9 @@ public:
         const auto query = ParseQuery(raw_query);
 
         auto matched_documents = FindAllDocuments(std::execution::par, query, document_predicate);
-        sort(std::execution::par, matched_documents.begin(), matched_documents.end(), [&](const Document& lhs, const Document& rhs) {
-            if (abs(lhs.relevance - rhs.relevance) < kRelevanceAccuracy) {
-                return lhs.rating > rhs.rating;
-            } else {
-                return lhs.relevance > rhs.relevance;
-            }
+        SEARCH_METRICS_STAGE(SearchStage::TOP_K);
+        sort(std::execution::par, matched_documents.begin(), matched_documents.end(), [this](const Document& lhs, const Document& rhs) {
+            return IsMoreRelevant(lhs, rhs);
         });
         if (matched_documents.size() > MAX_RESULT_DOCUMENT_COUNT) {
             matched_documents.resize(MAX_RESULT_DOCUMENT_COUNT);
@@ -102,6 +193,245 @@ public:
         return matched_documents;
     }
 
+    // Equals FindTopDocuments of every query. All queries are parsed first, then the posting list of every word
+    // is traversed once, adding to the relevance of all queries with this word. Queries with required words
+    // are searched one by one
+    template <typename DocumentPredicate>
+    std::vector<std::vector<Document>> FindTopDocumentsBatch(const std::vector<std::string_view>& raw_queries,
+                                                             DocumentPredicate document_predicate) const {
+        std::vector<std::vector<Document>> result(raw_queries.size());
+        std::vector<Query> queries;
+        queries.reserve(raw_queries.size());
+        std::map<std::string_view, std::vector<std::pair<size_t, double>>> word_to_queries; // map<WORD, vector<pair<QUERY_INDEX, WEIGHT>>>
+        for (size_t query_index = 0; query_index < raw_queries.size(); ++query_index) {
+            const Query& query = queries.emplace_back(ParseQuery(raw_queries[query_index]));
+            if (!query.required_words.empty()) {
+                FindTopDocumentsByQuery(query, document_predicate, nullptr, result[query_index]);
+                continue;
+            }
+            for (const auto [word, weight] : query.plus_words) {
+                word_to_queries[word].emplace_back(query_index, weight);
+            }
+        }
+
+        // Words go in the same order as in the plus-words of a query, so relevance is summed in the same order
+        // as in ComputeDocumentRelevance and is bit-identical to it
+        std::vector<std::map<int, double>> query_relevance(raw_queries.size()); // vector<map<DOCUMENT_ID, RELEVANCE>>
+        std::vector<std::pair<int, double>> postings; // pair<DOCUMENT_ID, TERM_FREQ> of documents passing document_predicate
+        for (const auto& [word, word_queries] : word_to_queries) {
+            const std::map<int, double>* document_freqs = nullptr;
+            {
+                SEARCH_METRICS_STAGE(SearchStage::POSTING_FETCH);
+                document_freqs = FindWordFreqs(word);
+            }
+            if (document_freqs == nullptr) {
+                continue;
+            }
+            SEARCH_METRICS_STAGE(SearchStage::SCORING);
+            SEARCH_METRICS_COUNT(SearchCounter::POSTINGS_SCANNED, document_freqs->size());
+            postings.clear();
+            for (const auto [ordinal, term_freq] : *document_freqs) {
+                const auto& document_data = documents_[ordinal];
+                const int document_id = document_data.id;
+                if (document_predicate(document_id, document_data.status, document_data.rating)) {
+                    postings.emplace_back(document_id, term_freq);
+                }
+            }
+            const double word_inverse_document_freq = ComputeWordInverseDocumentFreq(word, document_freqs->size());
+            for (const auto& [query_index, weight] : word_queries) {
+                const double inverse_document_freq = word_inverse_document_freq * weight;
+                auto& document_to_relevance = query_relevance[query_index];
+                for (const auto& [document_id, term_freq] : postings) {
+                    document_to_relevance[document_id] += term_freq * inverse_document_freq;
+                }
+            }
+        }
+
+        std::vector<const std::map<int, double>*> minus_word_freqs;
+        std::vector<Document> matched_documents;
+        for (size_t query_index = 0; query_index < raw_queries.size(); ++query_index) {
+            if (!queries[query_index].required_words.empty()) {
+                continue;
+            }
+            minus_word_freqs.clear();
+            for (std::string_view word : queries[query_index].minus_words) {
+                if (const auto* document_freqs = FindWordFreqs(word)) {
+                    minus_word_freqs.push_back(document_freqs);
+                }
+            }
+
+            matched_documents.clear();
+            for (const auto [document_id, relevance] : query_relevance[query_index]) {
+                const int ordinal = document_id_to_ordinal_.at(document_id);
+                if (none_of(minus_word_freqs.begin(), minus_word_freqs.end(), [ordinal](const auto* document_freqs) {
+                        return document_freqs->count(ordinal) != 0;
+                    })) {
+                    matched_documents.emplace_back(document_id, relevance, documents_[ordinal].rating);
+                }
+            }
+            SEARCH_METRICS_COUNT(SearchCounter::DOCUMENTS_MATCHED, matched_documents.size());
+            TakeTopDocuments(matched_documents, result[query_index]);
+        }
+        return result;
+    }
+
+    [[nodiscard]] std::vector<std::vector<Document>> FindTopDocumentsBatch(const std::vector<std::string_view>& raw_queries) const;
+
+    // Plus-words are processed from the rarest one until the budget of options is exhausted,
+    // minus-words are always applied in full. A query with required words is not limited by the budget:
+    // its cost is bounded by the rarest required word
+    template <typename DocumentPredicate>
+    SearchResult FindTopDocuments(std::string_view raw_query, const SearchOptions& options, DocumentPredicate document_predicate) const {
+        const auto deadline = options.GetDeadline(SearchOptions::Clock::now());
+        QueryArena arena;
+        const auto query = ParseQuery(raw_query, arena.GetResource(), options.mode);
+
+        SearchResult result;
+        const auto document_to_relevance = ComputeDocumentRelevance(query, deadline, options.max_postings,
+                                                                    document_predicate, result.is_partial);
+        SEARCH_METRICS_STAGE(SearchStage::TOP_K);
+        result.documents.reserve(MAX_RESULT_DOCUMENT_COUNT);
+        for (const auto [document_id, relevance] : document_to_relevance) {
+            PushTopDocument(result.documents, {document_id, relevance, GetDocumentData(document_id).rating}, MAX_RESULT_DOCUMENT_COUNT);
+        }
+        SortTopDocuments(result.documents);
+        return result;
+    }
+
+    [[nodiscard]] SearchResult FindTopDocuments(std::string_view raw_query, const SearchOptions& options) const;
+
+    // Score-at-a-time search: impact segments of the query words are taken from the highest impact down,
+    // adding exact tf * idf to the scores of their documents. The search stops once the upper bound of every
+    // document outside the top, (impact + 0.5) * quantum of each remaining segment, is below the top, so the
+    // result equals FindTopDocuments. Falls back to FindTopDocuments while the impact index is not built
+    template <typename DocumentPredicate>
+    std::vector<Document> FindTopDocumentsByImpact(std::string_view raw_query, DocumentPredicate document_predicate) const {
+        if (!impact_index_) {
+            return FindTopDocuments(raw_query, document_predicate);
+        }
+        const auto query = ParseQuery(raw_query);
+        if (!query.required_words.empty()) {
+            return FindTopDocumentsByQuery(query, document_predicate);
+        }
+
+        std::set<int> excluded_documents;
+        for (std::string_view word : query.minus_words) {
+            const auto* document_freqs = FindWordFreqs(word);
+            if (document_freqs == nullptr) {
+                continue;
+            }
+            for (const auto [ordinal, _] : *document_freqs) {
+                const int document_id = documents_[ordinal].id;
+                excluded_documents.insert(document_id);
+            }
+        }
+
+        const double quantum = impact_index_->GetImpactQuantum();
+        struct WordCursor {
+            const std::vector<ImpactIndex::Segment>* segments = nullptr;
+            size_t position = 0;
+            double weight = 1.0;
+
+            // Upper bound of the score a document of the remaining segments gets for the word
+            [[nodiscard]] double GetNextScoreBound(double quantum) const {
+                return position < segments->size() ? ((*segments)[position].impact + 0.5) * quantum * weight : 0.0;
+            }
+        };
+        std::vector<WordCursor> cursors;
+        for (const auto [word, weight] : query.plus_words) {
+            if (const auto* segments = impact_index_->FindSegments(word)) {
+                cursors.push_back({segments, 0, weight});
+            }
+        }
+
+        std::unordered_map<int, double> document_to_score; // exact score of the words seen so far
+        std::vector<int> top_document_ids;
+        // Upper bound of current scores of documents outside the top
+        double max_other_score = 0.0;
+        while (true) {
+            WordCursor* next_cursor = nullptr;
+            double remaining_score_bound = 0.0;
+            for (WordCursor& cursor : cursors) {
+                remaining_score_bound += cursor.GetNextScoreBound(quantum);
+                if (cursor.position < cursor.segments->size()
+                    && (next_cursor == nullptr || cursor.GetNextScoreBound(quantum) > next_cursor->GetNextScoreBound(quantum))) {
+                    next_cursor = &cursor;
+                }
+            }
+            if (next_cursor == nullptr) {
+                break;
+            }
+            if (top_document_ids.size() == MAX_RESULT_DOCUMENT_COUNT) {
+                double threshold = document_to_score.at(top_document_ids.front());
+                for (const int document_id : top_document_ids) {
+                    threshold = std::min(threshold, document_to_score.at(document_id));
+                }
+                // Scores within kRelevanceAccuracy rank by rating, so they must stay out of reach too
+                if (max_other_score + remaining_score_bound < threshold - kRelevanceAccuracy) {
+                    break;
+                }
+            }
+
+            const ImpactIndex::Segment& segment = (*next_cursor->segments)[next_cursor->position++];
+            SEARCH_METRICS_COUNT(SearchCounter::POSTINGS_SCANNED, segment.document_ids.size());
+            for (size_t i = 0; i < segment.document_ids.size(); ++i) {
+                const int document_id = segment.document_ids[i];
+                if (excluded_documents.count(document_id) != 0) {
+                    continue;
+                }
+                const auto& document_data = GetDocumentData(document_id);
+                if (!document_predicate(document_id, document_data.status, document_data.rating)) {
+                    continue;
+                }
+                const double score = document_to_score[document_id] += segment.scores[i] * next_cursor->weight;
+                if (find(top_document_ids.begin(), top_document_ids.end(), document_id) != top_document_ids.end()) {
+                    continue;
+                }
+                if (top_document_ids.size() < MAX_RESULT_DOCUMENT_COUNT) {
+                    top_document_ids.push_back(document_id);
+                    continue;
+                }
+                // Ranked as in FindTopDocuments, so equal scores are resolved by rating and id the same way
+                const auto to_document = [&](int id) { return Document(id, document_to_score.at(id), GetDocumentData(id).rating); };
+                const auto weakest = max_element(top_document_ids.begin(), top_document_ids.end(), [&](int lhs, int rhs) {
+                    return IsMoreRelevant(to_document(lhs), to_document(rhs));
+                });
+                const double weakest_score = document_to_score.at(*weakest);
+                if (IsMoreRelevant(Document(document_id, score, document_data.rating), to_document(*weakest))) {
+                    max_other_score = std::max(max_other_score, weakest_score);
+                    *weakest = document_id;
+                } else {
+                    max_other_score = std::max(max_other_score, score);
+                }
+            }
+        }
+
+        // Rescored word by word in the order of FindTopDocuments, so relevance is the same to the last bit
+        std::vector<Document> top_documents;
+        top_documents.reserve(top_document_ids.size());
+        for (const int document_id : top_document_ids) {
+            top_documents.emplace_back(document_id, 0.0, GetDocumentData(document_id).rating);
+        }
+        for (const auto [word, weight] : query.plus_words) {
+            const auto* document_freqs = FindWordFreqs(word);
+            if (document_freqs == nullptr) {
+                continue;
+            }
+            const double inverse_document_freq = ComputeWordInverseDocumentFreq(word, document_freqs->size()) * weight;
+            for (Document& document : top_documents) {
+                if (const auto it = document_freqs->find(document_id_to_ordinal_.at(document.id)); it != document_freqs->end()) {
+                    document.relevance += it->second * inverse_document_freq;
+                }
+            }
+        }
+        sort(top_documents.begin(), top_documents.end(), [this](const Document& lhs, const Document& rhs) {
+            return IsMoreRelevant(lhs, rhs);
+        });
+        return top_documents;
+    }
+
+    [[nodiscard]] std::vector<Document> FindTopDocumentsByImpact(std::string_view raw_query) const;
+
     [[nodiscard]] std::vector<Document> FindTopDocuments(std::string_view raw_query, DocumentStatus status) const;
 
     [[nodiscard]] std::vector<Document> FindTopDocuments(execution::sequenced_policy, std::string_view raw_query, DocumentStatus status) const;
@@ -114,8 +444,110 @@ public:
 
     [[nodiscard]] std::vector<Document> FindTopDocuments(execution::parallel_policy, std::string_view raw_query) const;
 
+    // Top documents with the best window of window_size words of their stored text as HTML: matched words
+    // are in <b>, the text is escaped. Snippets are empty for documents added while the document store was disabled
+    template <typename DocumentPredicate>
+    std::vector<DocumentSnippet> FindTopDocumentsWithSnippets(std::string_view raw_query, size_t window_size,
+                                                              DocumentPredicate document_predicate) const {
+        const auto query = ParseQuery(raw_query);
+        // Scores of the query words are kept by the search instead of looking the words up again
+        std::map<std::string_view, double> word_scores;
+        const auto document_to_relevance = ComputeDocumentRelevance(query, document_predicate, nullptr, &word_scores);
+        std::pmr::vector<Document> matched_documents(query.GetResource());
+        matched_documents.reserve(document_to_relevance.size());
+        for (const auto [document_id, relevance] : document_to_relevance) {
+            matched_documents.emplace_back(document_id, relevance, GetDocumentData(document_id).rating);
+        }
+        std::vector<Document> top_documents;
+        TakeTopDocuments(matched_documents, top_documents);
+
+        std::vector<DocumentSnippet> result(top_documents.size());
+        transform(
+                std::execution::par,
+                top_documents.begin(), top_documents.end(),
+                result.begin(),
+                [&](const Document& document) {
+                    return DocumentSnippet{document, BuildSnippet(word_scores, document.id, window_size)};
+                });
+        return result;
+    }
+
+    [[nodiscard]] std::vector<DocumentSnippet> FindTopDocumentsWithSnippets(std::string_view raw_query,
+                                                                            size_t window_size = kDefaultSnippetWordCount) const;
+
+    // One pass over all documents matching the query: facets ignore document_predicate,
+    // top documents are filtered by it. rating_bounds must be sorted
+    template <typename DocumentPredicate>
+    std::pair<std::vector<Document>, SearchAggregation> FindTopDocumentsWithAggregation(std::string_view raw_query,
+                                                                                        const std::vector<int>& rating_bounds,
+                                                                                        DocumentPredicate document_predicate) const {
+        QueryArena arena;
+        const auto query = ParseQuery(raw_query, arena.GetResource());
+        const auto document_to_relevance = ComputeDocumentRelevance(query, [](int, DocumentStatus, int) { return true; });
+
+        SearchAggregation aggregation;
+        aggregation.rating_histogram.assign(rating_bounds.size() + 1, 0);
+        std::vector<Document> top_documents;
+        top_documents.reserve(MAX_RESULT_DOCUMENT_COUNT);
+        for (const auto [document_id, relevance] : document_to_relevance) {
+            const auto& document_data = GetDocumentData(document_id);
+            ++aggregation.total_hits;
+            ++aggregation.status_counts[static_cast<size_t>(document_data.status)];
+            ++aggregation.rating_histogram[upper_bound(rating_bounds.begin(), rating_bounds.end(), document_data.rating) - rating_bounds.begin()];
+
+            if (document_predicate(document_id, document_data.status, document_data.rating)) {
+                PushTopDocument(top_documents, {document_id, relevance, document_data.rating}, MAX_RESULT_DOCUMENT_COUNT);
+            }
+        }
+        SortTopDocuments(top_documents);
+
+        return {top_documents, aggregation};
+    }
+
+    [[nodiscard]] std::pair<std::vector<Document>, SearchAggregation> FindTopDocumentsWithAggregation(std::string_view raw_query,
+                                                                                                      const std::vector<int>& rating_bounds) const;
+
+    // Up to page_size top documents ranked by IsMoreRelevant strictly below cursor, or from the top when there
+    // is no cursor. Documents are ranked the same way as in FindTopDocuments, so the first page equals its result
+    template <typename DocumentPredicate>
+    std::vector<Document> FindTopDocumentsAfter(std::string_view raw_query, const std::optional<SearchCursor>& cursor, size_t page_size,
+                                                DocumentPredicate document_predicate) const {
+        QueryArena arena;
+        const auto query = ParseQuery(raw_query, arena.GetResource());
+        const auto document_to_relevance = ComputeDocumentRelevance(query, document_predicate);
+
+        std::optional<Document> cursor_document;
+        if (cursor) {
+            cursor_document.emplace(cursor->id, cursor->relevance, cursor->rating);
+        }
+        // Ranked like in TakeTopDocuments: sorting all documents in id order, not with a heap, gives the same
+        // order as FindTopDocuments even for documents whose relevance differs by less than kRelevanceAccuracy
+        std::vector<Document> top_documents;
+        for (const auto [document_id, relevance] : document_to_relevance) {
+            const Document document(document_id, relevance, GetDocumentData(document_id).rating);
+            if (!cursor_document || IsMoreRelevant(*cursor_document, document)) {
+                top_documents.push_back(document);
+            }
+        }
+        sort(top_documents.begin(), top_documents.end(), [](const Document& lhs, const Document& rhs) {
+            return IsMoreRelevant(lhs, rhs);
+        });
+        if (top_documents.size() > page_size) {
+            top_documents.resize(page_size);
+        }
+
+        return top_documents;
+    }
+
+    [[nodiscard]] std::vector<Document> FindTopDocumentsAfter(std::string_view raw_query, const std::optional<SearchCursor>& cursor,
+                                                              size_t page_size) const;
+
+    // Matched words point to the words interned by the server, not into raw_query, and live as long as the server
     [[nodiscard]] std::tuple<std::vector<std::string_view>, DocumentStatus> MatchDocument(std::string_view raw_query, int document_id) const;
 
+    // Ranking order: relevance, then rating, then id so that every document has a stable position
+    [[nodiscard]] static bool IsMoreRelevant(const Document& lhs, const Document& rhs);
+
     [[nodiscard]] std::tuple<std::vector<std::string_view>, DocumentStatus> MatchDocument(std::execution::sequenced_policy,
                                                                                      std::string_view raw_query,
                                                                                      int document_id) const;
@@ -124,8 +556,20 @@ public:
                                                                                      std::string_view raw_query,
                                                                                      int document_id) const;
 
+private:
+    static constexpr size_t kDefaultSnippetWordCount = 10;
+    // Postings scanned between two reads of the clock in budgeted search
+    static constexpr size_t kDeadlineCheckInterval = 1024;
+    static constexpr size_t kReorderSignatureSize = 4;
+    // Words of more than 1 / kReorderMaxWordShare of documents are not used for reordering
+    static constexpr size_t kReorderMaxWordShare = 20;
+    // Intersection looks documents up in postings this many times longer instead of walking them
+    static constexpr size_t kTreeSearchRatio = 16;
+    static constexpr size_t kInitialVocabularyFilterCapacity = 1024;
+
 private:
     struct DocumentData {
+        int id = 0;
         int rating = 0;
         DocumentStatus status = DocumentStatus::ACTUAL;
     };
@@ -134,114 +578,376 @@ private:
         std::string_view data;
         bool is_minus = false;
         bool is_stop = false;
+        bool is_required = false;
     };
 
+    // Containers of the query and of its intermediate results are allocated from one memory resource
     struct Query {
-        std::set<string_view> plus_words;
-        std::set<string_view> minus_words;
+        explicit Query(std::pmr::memory_resource* resource)
+                : plus_words(resource)
+                , minus_words(resource)
+                , required_words(resource) {
+        }
+
+        [[nodiscard]] std::pmr::memory_resource* GetResource() const {
+            return plus_words.get_allocator().resource();
+        }
+
+        std::pmr::map<string_view, double> plus_words; // map<WORD, WEIGHT>
+        std::pmr::set<string_view> minus_words;
+        // Plus-words every found document must contain, the others only add to relevance
+        std::pmr::set<string_view> required_words;
     };
 
 private:
     static constexpr double kNumberForComparisonDots = 1e-6;
+    static constexpr double kRelevanceAccuracy = 1e-6;
+    // Relevance multiplier for every edit between a query word and its fuzzy expansion
+    static constexpr double kFuzzyWordPenalty = 0.5;
+    // Without the caps a short query word expands to hundreds of dictionary words and each is searched
+    static constexpr size_t kMaxFuzzyExpansions = 3;
+    static constexpr size_t kMinTwoEditWordLength = 6;
 
 private:
     static bool IsValidWord(std::string_view word);
 
     static int ComputeAverageRating(const vector<int>& ratings);
 
+    [[nodiscard]] const DocumentData& GetDocumentData(int document_id) const;
+
     [[nodiscard]] bool IsStopWord(std::string_view word) const;
 
+    // Postings of the word or nullptr; unknown words are mostly rejected by the vocabulary filter
+    [[nodiscard]] const std::map<int, double>* FindWordFreqs(std::string_view word) const;
+
+    // Entry of the word in the index or nullptr, its key is the copy of the word owned by the server
+    [[nodiscard]] const std::pair<const std::string_view, std::map<int, double>>* FindWordEntry(std::string_view word) const;
+
+    // Rebuilds the filter with twice the capacity once it is full
+    void AddToVocabularyFilter(std::string_view word);
+
     [[nodiscard]] std::vector<std::string_view> SplitIntoWordsNoStop(std::string_view text) const;
 
     [[nodiscard]] QueryWord ParseQueryWord(std::string_view text) const;
 
-    [[nodiscard]] Query ParseQuery(std::string_view text) const;
+    // Words starting with + are required, in ALL mode every plus-word is. Fuzzy expansions are never required.
+    // Words of the query are views into text (fuzzy expansions into the fuzzy index), so the query must not
+    // outlive text and nothing taken from it may be returned to the caller without copying or interning
+    [[nodiscard]] Query ParseQuery(std::string_view text, std::pmr::memory_resource* resource = std::pmr::get_default_resource(),
+                                   QueryMode mode = QueryMode::ANY) const;
+
+    // IDF from statistics if they are given and know the word, from document_freq of this server otherwise
+    [[nodiscard]] double ComputeWordInverseDocumentFreq(std::string_view word, size_t document_freq,
+                                                        const CorpusStatistics* statistics = nullptr) const;
+
+    // Window of the stored text with the largest sum of scores of distinct matched words
+    [[nodiscard]] std::string BuildSnippet(const std::map<std::string_view, double>& word_scores, int document_id,
+                                           size_t window_size) const;
 
-    [[nodiscard]] double ComputeWordInverseDocumentFreq(std::string_view word) const;
+    // top_documents is a heap with the least relevant document on top, kept at no more than limit elements
+    void PushTopDocument(std::vector<Document>& top_documents, const Document& document, size_t limit) const;
+
+    // Turns the heap built by PushTopDocument into a ranked list
+    void SortTopDocuments(std::vector<Document>& top_documents) const;
+
+    template <typename DocumentPredicate>
+    void FindTopDocumentsByQuery(const Query& query, DocumentPredicate document_predicate, const CorpusStatistics* statistics,
+                                 std::vector<Document>& top_documents) const {
+        auto matched_documents = FindAllDocuments(query, document_predicate, statistics);
+        TakeTopDocuments(matched_documents, top_documents);
+    }
+
+    // Ranks matched_documents in place and copies the first MAX_RESULT_DOCUMENT_COUNT of them
+    template <typename Documents>
+    void TakeTopDocuments(Documents& matched_documents, std::vector<Document>& top_documents) const {
+        SEARCH_METRICS_STAGE(SearchStage::TOP_K);
+        sort(matched_documents.begin(), matched_documents.end(), [this](const Document& lhs, const Document& rhs) {
+            return IsMoreRelevant(lhs, rhs);
+        });
+        top_documents.assign(matched_documents.begin(),
+                             matched_documents.begin() + static_cast<ptrdiff_t>(std::min<size_t>(matched_documents.size(), MAX_RESULT_DOCUMENT_COUNT)));
+    }
 
     template <typename DocumentPredicate>
-    std::vector<Document> FindAllDocuments(const Query& query, DocumentPredicate document_predicate) const {
-        std::map<int, double> document_to_relevance;
-        for (std::string_view word : query.plus_words) {
-            if (word_to_document_freqs_.count(word) == 0) {
+    std::vector<Document> FindTopDocumentsByQuery(const Query& query, DocumentPredicate document_predicate,
+                                                  const CorpusStatistics* statistics = nullptr) const {
+        std::vector<Document> top_documents;
+        FindTopDocumentsByQuery(query, document_predicate, statistics, top_documents);
+        return top_documents;
+    }
+
+    // Keeps the sorted ordinals found in document_freqs
+    static void IntersectWithPostings(std::pmr::vector<int>& ordinals, const std::map<int, double>& document_freqs);
+
+    // Postings of the required words are intersected from the rarest one, then only the documents
+    // left are checked against minus-words and scored with all plus-words
+    template <typename DocumentPredicate>
+    std::pmr::map<int, double> ComputeConjunctiveRelevance(const Query& query, DocumentPredicate document_predicate,
+                                                           const CorpusStatistics* statistics,
+                                                           std::map<std::string_view, double>* word_scores = nullptr) const {
+        std::pmr::map<int, double> document_to_relevance(query.GetResource());
+        std::pmr::vector<std::pair<const std::map<int, double>*, double>> plus_word_freqs(query.GetResource()); // pair<FREQS, IDF * WEIGHT>
+        std::pmr::vector<const std::map<int, double>*> required_word_freqs(query.GetResource());
+        std::pmr::vector<const std::map<int, double>*> minus_word_freqs(query.GetResource());
+        {
+            SEARCH_METRICS_STAGE(SearchStage::POSTING_FETCH);
+            for (const auto [word, weight] : query.plus_words) {
+                const auto* document_freqs = FindWordFreqs(word);
+                const bool is_required = query.required_words.count(word) != 0;
+                if (document_freqs == nullptr || document_freqs->empty()) {
+                    if (is_required) {
+                        return document_to_relevance;
+                    }
+                    continue;
+                }
+                plus_word_freqs.emplace_back(document_freqs, ComputeWordInverseDocumentFreq(word, document_freqs->size(), statistics) * weight);
+                if (word_scores != nullptr) {
+                    (*word_scores)[word] = plus_word_freqs.back().second;
+                }
+                if (is_required) {
+                    required_word_freqs.push_back(document_freqs);
+                }
+            }
+            for (std::string_view word : query.minus_words) {
+                if (const auto* document_freqs = FindWordFreqs(word)) {
+                    minus_word_freqs.push_back(document_freqs);
+                }
+            }
+        }
+
+        std::pmr::vector<int> ordinals(query.GetResource());
+        {
+            SEARCH_METRICS_STAGE(SearchStage::INTERSECTION);
+            sort(required_word_freqs.begin(), required_word_freqs.end(), [](const auto* lhs, const auto* rhs) { return lhs->size() < rhs->size(); });
+            ordinals.reserve(required_word_freqs.front()->size());
+            for (const auto [ordinal, _] : *required_word_freqs.front()) {
+                ordinals.push_back(ordinal);
+            }
+            SEARCH_METRICS_COUNT(SearchCounter::POSTINGS_SCANNED, ordinals.size());
+            for (size_t i = 1; i < required_word_freqs.size() && !ordinals.empty(); ++i) {
+                IntersectWithPostings(ordinals, *required_word_freqs[i]);
+            }
+        }
+
+        SEARCH_METRICS_STAGE(SearchStage::SCORING);
+        for (const int ordinal : ordinals) {
+            const auto& document_data = documents_[ordinal];
+            if (!document_predicate(document_data.id, document_data.status, document_data.rating)) {
                 continue;
             }
-            const double inverse_document_freq = ComputeWordInverseDocumentFreq(word);
-            for (const auto [document_id, term_freq] : word_to_document_freqs_.at(word)) {
-                const auto& document_data = documents_.at(document_id);
+            if (any_of(minus_word_freqs.begin(), minus_word_freqs.end(), [ordinal](const auto* document_freqs) {
+                    return document_freqs->count(ordinal) != 0;
+                })) {
+                continue;
+            }
+            double relevance = 0.0;
+            for (const auto& [document_freqs, inverse_document_freq] : plus_word_freqs) {
+                if (const auto it = document_freqs->find(ordinal); it != document_freqs->end()) {
+                    relevance += it->second * inverse_document_freq;
+                }
+            }
+            document_to_relevance.emplace(document_data.id, relevance);
+        }
+        SEARCH_METRICS_COUNT(SearchCounter::DOCUMENTS_MATCHED, document_to_relevance.size());
+        return document_to_relevance;
+    }
+
+    // map<DOCUMENT_ID, RELEVANCE> of documents with plus-words and without minus-words.
+    // word_scores gets IDF * weight of the plus-words found in the index
+    template <typename DocumentPredicate>
+    std::pmr::map<int, double> ComputeDocumentRelevance(const Query& query, DocumentPredicate document_predicate,
+                                                        const CorpusStatistics* statistics = nullptr,
+                                                        std::map<std::string_view, double>* word_scores = nullptr) const {
+        if (!query.required_words.empty()) {
+            return ComputeConjunctiveRelevance(query, document_predicate, statistics, word_scores);
+        }
+        std::pmr::map<int, double> document_to_relevance(query.GetResource());
+        for (const auto [word, weight] : query.plus_words) {
+            const std::map<int, double>* document_freqs = nullptr;
+            {
+                SEARCH_METRICS_STAGE(SearchStage::POSTING_FETCH);
+                document_freqs = FindWordFreqs(word);
+            }
+            if (document_freqs == nullptr) {
+                continue;
+            }
+            SEARCH_METRICS_STAGE(SearchStage::SCORING);
+            const double inverse_document_freq = ComputeWordInverseDocumentFreq(word, document_freqs->size(), statistics) * weight;
+            if (word_scores != nullptr) {
+                (*word_scores)[word] = inverse_document_freq;
+            }
+            SEARCH_METRICS_COUNT(SearchCounter::POSTINGS_SCANNED, document_freqs->size());
+            for (const auto [ordinal, term_freq] : *document_freqs) {
+                const auto& document_data = documents_[ordinal];
+                const int document_id = document_data.id;
                 if (document_predicate(document_id, document_data.status, document_data.rating)) {
                     document_to_relevance[document_id] += term_freq * inverse_document_freq;
                 }
             }
         }
 
-        for (std::string_view word : query.minus_words) {
-            if (word_to_document_freqs_.count(word) == 0) {
-                continue;
+        {
+            SEARCH_METRICS_STAGE(SearchStage::MINUS_FILTER);
+            for (std::string_view word : query.minus_words) {
+                const auto* document_freqs = FindWordFreqs(word);
+                if (document_freqs == nullptr) {
+                    continue;
+                }
+                for (const auto [ordinal, _] : *document_freqs) {
+                    const int document_id = documents_[ordinal].id;
+                    document_to_relevance.erase(document_id);
+                }
             }
-            for (const auto [document_id, _] : word_to_document_freqs_.at(word)) {
-                document_to_relevance.erase(document_id);
+        }
+        SEARCH_METRICS_COUNT(SearchCounter::DOCUMENTS_MATCHED, document_to_relevance.size());
+        return document_to_relevance;
+    }
+
+    // Budgeted version: plus-words go in descending IDF order, is_partial is set if the budget ran out
+    template <typename DocumentPredicate>
+    std::pmr::map<int, double> ComputeDocumentRelevance(const Query& query, std::optional<SearchOptions::Clock::time_point> deadline,
+                                                        size_t max_postings, DocumentPredicate document_predicate, bool& is_partial) const {
+        if (!query.required_words.empty()) {
+            return ComputeConjunctiveRelevance(query, document_predicate, nullptr);
+        }
+        std::pmr::vector<std::pair<const std::map<int, double>*, double>> plus_word_freqs(query.GetResource()); // pair<FREQS, IDF * WEIGHT>
+        for (const auto [word, weight] : query.plus_words) {
+            SEARCH_METRICS_STAGE(SearchStage::POSTING_FETCH);
+            if (const auto* document_freqs = FindWordFreqs(word)) {
+                plus_word_freqs.emplace_back(document_freqs, ComputeWordInverseDocumentFreq(word, document_freqs->size()) * weight);
+            }
+        }
+        sort(plus_word_freqs.begin(), plus_word_freqs.end(), [](const auto& lhs, const auto& rhs) { return lhs.second > rhs.second; });
+
+        std::pmr::map<int, double> document_to_relevance(query.GetResource());
+        size_t postings_left = max_postings;
+        for (const auto& [document_freqs, inverse_document_freq] : plus_word_freqs) {
+            SEARCH_METRICS_STAGE(SearchStage::SCORING);
+            size_t scanned = 0;
+            for (const auto [ordinal, term_freq] : *document_freqs) {
+                if (postings_left == 0
+                    || (deadline && scanned % kDeadlineCheckInterval == 0 && SearchOptions::Clock::now() >= *deadline)) {
+                    is_partial = true;
+                    break;
+                }
+                --postings_left;
+                ++scanned;
+                const auto& document_data = documents_[ordinal];
+                if (document_predicate(document_data.id, document_data.status, document_data.rating)) {
+                    document_to_relevance[document_data.id] += term_freq * inverse_document_freq;
+                }
+            }
+            SEARCH_METRICS_COUNT(SearchCounter::POSTINGS_SCANNED, scanned);
+            if (is_partial) {
+                break;
             }
         }
 
-        std::vector<Document> matched_documents;
+        {
+            SEARCH_METRICS_STAGE(SearchStage::MINUS_FILTER);
+            for (std::string_view word : query.minus_words) {
+                const auto* document_freqs = FindWordFreqs(word);
+                if (document_freqs == nullptr) {
+                    continue;
+                }
+                for (const auto [ordinal, _] : *document_freqs) {
+                    const int document_id = documents_[ordinal].id;
+                    document_to_relevance.erase(document_id);
+                }
+            }
+        }
+        SEARCH_METRICS_COUNT(SearchCounter::DOCUMENTS_MATCHED, document_to_relevance.size());
+        return document_to_relevance;
+    }
+
+    template <typename DocumentPredicate>
+    std::pmr::vector<Document> FindAllDocuments(const Query& query, DocumentPredicate document_predicate,
+                                                const CorpusStatistics* statistics = nullptr) const {
+        const auto document_to_relevance = ComputeDocumentRelevance(query, document_predicate, statistics);
+
+        std::pmr::vector<Document> matched_documents(query.GetResource());
         matched_documents.reserve(document_to_relevance.size());
         for (const auto [document_id, relevance] : document_to_relevance) {
-            matched_documents.emplace_back(document_id, relevance, documents_.at(document_id).rating);
+            matched_documents.emplace_back(document_id, relevance, GetDocumentData(document_id).rating);
         }
         return matched_documents;
     }
 
     template <typename DocumentPredicate>
-    std::vector<Document> FindAllDocuments(execution::sequenced_policy, const Query& query, DocumentPredicate document_predicate) const {
+    std::pmr::vector<Document> FindAllDocuments(execution::sequenced_policy, const Query& query, DocumentPredicate document_predicate) const {
         return FindAllDocuments(query, document_predicate);
     }
 
     template <typename DocumentPredicate>
     std::vector<Document> FindAllDocuments(execution::parallel_policy, const Query& query, DocumentPredicate document_predicate) const {
+        if (!query.required_words.empty()) {
+            // Only the few documents left after the intersection are scored, there is nothing to parallelize
+            const auto matched_documents = FindAllDocuments(query, document_predicate);
+            return {matched_documents.begin(), matched_documents.end()};
+        }
         ConcurrentMap<int, double> document_to_relevance_concurrent(word_to_document_freqs_.size());
-        for (std::string_view word : query.plus_words) {
-            if (word_to_document_freqs_.count(word) == 0) {
+        for (const auto [word, weight] : query.plus_words) {
+            const std::map<int, double>* document_freqs = nullptr;
+            {
+                SEARCH_METRICS_STAGE(SearchStage::POSTING_FETCH);
+                document_freqs = FindWordFreqs(word);
+            }
+            if (document_freqs == nullptr) {
                 continue;
             }
-            const double inverse_document_freq = ComputeWordInverseDocumentFreq(word);
+            SEARCH_METRICS_STAGE(SearchStage::SCORING);
+            const double inverse_document_freq = ComputeWordInverseDocumentFreq(word, document_freqs->size()) * weight;
+            SEARCH_METRICS_COUNT(SearchCounter::POSTINGS_SCANNED, document_freqs->size());
             for_each(
                     execution::par,
-                    word_to_document_freqs_.at(word).begin(), word_to_document_freqs_.at(word).end(),
+                    document_freqs->begin(), document_freqs->end(),
                     [&](auto& element) {
-                        const auto& document_data = documents_.at(element.first);
-                        if (document_predicate(element.first, document_data.status, document_data.rating)) {
-                            document_to_relevance_concurrent[element.first].ref_to_value += element.second * inverse_document_freq;
+                        const auto& document_data = documents_[element.first];
+                        if (document_predicate(document_data.id, document_data.status, document_data.rating)) {
+                            document_to_relevance_concurrent[document_data.id].ref_to_value += element.second * inverse_document_freq;
                         }
                     });
         }
         map<int, double> document_to_relevance = document_to_relevance_concurrent.BuildOrdinaryMap();
 
-        for (std::string_view word : query.minus_words) {
-            if (word_to_document_freqs_.count(word) == 0) {
-                continue;
-            }
-
-            for (const auto [document_id, _] : word_to_document_freqs_.at(word)) {
-                document_to_relevance.erase(document_id);
+        {
+            SEARCH_METRICS_STAGE(SearchStage::MINUS_FILTER);
+            for (std::string_view word : query.minus_words) {
+                const auto* document_freqs = FindWordFreqs(word);
+                if (document_freqs == nullptr) {
+                    continue;
+                }
+                for (const auto [ordinal, _] : *document_freqs) {
+                    const int document_id = documents_[ordinal].id;
+                    document_to_relevance.erase(document_id);
+                }
             }
         }
+        SEARCH_METRICS_COUNT(SearchCounter::DOCUMENTS_MATCHED, document_to_relevance.size());
 
         std::vector<Document> matched_documents;
         matched_documents.reserve(document_to_relevance.size());
         for (const auto [document_id, relevance] : document_to_relevance) {
-            matched_documents.emplace_back(document_id, relevance, documents_.at(document_id).rating);
+            matched_documents.emplace_back(document_id, relevance, GetDocumentData(document_id).rating);
         }
         return matched_documents;
     }
 
 private:
     set<string> all_words_;
-    std::set<std::string_view> stop_words_;
-    std::map<std::string_view, std::map<int, double>> word_to_document_freqs_; // map<WORD, map<DOCUMENT_ID, FREQUENCY>>
-    std::map<int, DocumentData> documents_;
+    PerfectHashSet stop_words_;
+    std::map<std::string_view, std::map<int, double>> word_to_document_freqs_; // map<WORD, map<DOCUMENT_ORDINAL, FREQUENCY>>
+    // Every word ever added to word_to_document_freqs_
+    BloomFilter vocabulary_filter_;
+    // Documents by ordinal, their position in posting lists. Ordinals of removed documents are given to
+    // new documents, so the vector does not outgrow the largest document count
+    std::vector<DocumentData> documents_;
+    std::unordered_map<int, int> document_id_to_ordinal_;
+    std::vector<int> free_ordinals_;
     std::vector<int> document_ids_;
-    double kRelevanceAccuracy = 1e-6;
+    std::optional<FuzzyIndex> fuzzy_index_;
+    std::optional<DocumentStore> document_store_;
+    std::optional<ImpactIndex> impact_index_;
 };
 
 void PrintDocument(const Document& document);
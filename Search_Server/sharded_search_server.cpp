@@ -0,0 +1,153 @@
+#include "sharded_search_server.h"
+
+#include <execution>
+#include <mutex>
+#include <numeric>
+#include <queue>
+#include <stdexcept>
+
+LocalShard::LocalShard(std::string_view stop_words_text)
+    : search_server_(stop_words_text) {
+}
+
+void LocalShard::AddDocument(int document_id, std::string_view document, DocumentStatus status, const std::vector<int>& ratings) {
+    std::unique_lock lock(mutex_);
+    search_server_.AddDocument(document_id, document, status, ratings);
+}
+
+void LocalShard::RemoveDocument(int document_id) {
+    std::unique_lock lock(mutex_);
+    search_server_.RemoveDocument(document_id);
+}
+
+[[nodiscard]] size_t LocalShard::GetDocumentCount() const {
+    std::shared_lock lock(mutex_);
+    return search_server_.GetDocumentCount();
+}
+
+[[nodiscard]] CorpusStatistics LocalShard::GetQueryStatistics(std::string_view raw_query) const {
+    std::shared_lock lock(mutex_);
+    return search_server_.GetQueryStatistics(raw_query);
+}
+
+[[nodiscard]] std::vector<Document> LocalShard::FindTopDocuments(std::string_view raw_query, const CorpusStatistics& statistics,
+                                                                 DocumentStatus status) const {
+    std::shared_lock lock(mutex_);
+    return search_server_.FindTopDocuments(raw_query, statistics, status);
+}
+
+ShardedSearchServer::ShardedSearchServer(std::string_view stop_words_text, size_t shard_count) {
+    if (shard_count == 0) {
+        throw std::invalid_argument("Shard count must be positive");
+    }
+    shards_.reserve(shard_count);
+    for (size_t i = 0; i < shard_count; ++i) {
+        shards_.push_back(std::make_unique<LocalShard>(stop_words_text));
+    }
+}
+
+ShardedSearchServer::ShardedSearchServer(std::vector<std::unique_ptr<ShardTransport>> shards)
+    : shards_(std::move(shards)) {
+    if (shards_.empty()) {
+        throw std::invalid_argument("Shard count must be positive");
+    }
+}
+
+void ShardedSearchServer::AddDocument(int document_id, std::string_view document, DocumentStatus status, const std::vector<int>& ratings) {
+    if (document_id < 0) {
+        throw std::invalid_argument("Not valid document id");
+    }
+    shards_[GetShardIndex(document_id)]->AddDocument(document_id, document, status, ratings);
+}
+
+void ShardedSearchServer::AddDocuments(const std::vector<DocumentRecord>& documents) {
+    std::vector<std::vector<const DocumentRecord*>> shard_documents(shards_.size());
+    for (const DocumentRecord& document : documents) {
+        if (document.id < 0) {
+            throw std::invalid_argument("Not valid document id");
+        }
+        shard_documents[GetShardIndex(document.id)].push_back(&document);
+    }
+
+    std::vector<size_t> shard_indexes(shards_.size());
+    std::iota(shard_indexes.begin(), shard_indexes.end(), 0);
+    std::for_each(
+            std::execution::par,
+            shard_indexes.begin(), shard_indexes.end(),
+            [this, &shard_documents](size_t shard_index) {
+                for (const DocumentRecord* document : shard_documents[shard_index]) {
+                    shards_[shard_index]->AddDocument(document->id, document->text, document->status, document->ratings);
+                }
+            });
+}
+
+void ShardedSearchServer::RemoveDocument(int document_id) {
+    if (document_id < 0) {
+        return;
+    }
+    shards_[GetShardIndex(document_id)]->RemoveDocument(document_id);
+}
+
+[[nodiscard]] size_t ShardedSearchServer::GetDocumentCount() const {
+    size_t document_count = 0;
+    for (const auto& shard : shards_) {
+        document_count += shard->GetDocumentCount();
+    }
+    return document_count;
+}
+
+[[nodiscard]] size_t ShardedSearchServer::GetShardCount() const {
+    return shards_.size();
+}
+
+[[nodiscard]] std::vector<Document> ShardedSearchServer::FindTopDocuments(std::string_view raw_query, DocumentStatus status) const {
+    // Scatter 1: document frequencies of the query words
+    std::vector<CorpusStatistics> shard_statistics(shards_.size());
+    std::transform(
+            std::execution::par,
+            shards_.begin(), shards_.end(),
+            shard_statistics.begin(),
+            [raw_query](const auto& shard) { return shard->GetQueryStatistics(raw_query); });
+    CorpusStatistics statistics;
+    for (const CorpusStatistics& shard_statistic : shard_statistics) {
+        statistics.Merge(shard_statistic);
+    }
+
+    // Scatter 2: top documents of every shard scored with the global statistics
+    std::vector<std::vector<Document>> shard_results(shards_.size());
+    std::transform(
+            std::execution::par,
+            shards_.begin(), shards_.end(),
+            shard_results.begin(),
+            [raw_query, &statistics, status](const auto& shard) { return shard->FindTopDocuments(raw_query, statistics, status); });
+
+    // Gather: k-way merge of the ranked lists
+    using Position = std::pair<size_t, size_t>; // pair<SHARD, INDEX>
+    const auto is_less_relevant = [&shard_results](const Position& lhs, const Position& rhs) {
+        return SearchServer::IsMoreRelevant(shard_results[rhs.first][rhs.second], shard_results[lhs.first][lhs.second]);
+    };
+    std::priority_queue<Position, std::vector<Position>, decltype(is_less_relevant)> heads(is_less_relevant);
+    for (size_t shard = 0; shard < shard_results.size(); ++shard) {
+        if (!shard_results[shard].empty()) {
+            heads.push({shard, 0});
+        }
+    }
+
+    std::vector<Document> result;
+    while (!heads.empty() && result.size() < MAX_RESULT_DOCUMENT_COUNT) {
+        const auto [shard, index] = heads.top();
+        heads.pop();
+        result.push_back(shard_results[shard][index]);
+        if (index + 1 < shard_results[shard].size()) {
+            heads.push({shard, index + 1});
+        }
+    }
+    return result;
+}
+
+[[nodiscard]] size_t ShardedSearchServer::GetShardIndex(int document_id) const {
+    // Mixes the bits so that ids with a common stride still spread over all shards
+    uint64_t hash = static_cast<uint64_t>(document_id) * 0x9E3779B97F4A7C15ull;
+    hash ^= hash >> 32;
+    return static_cast<size_t>(hash % shards_.size());
+}
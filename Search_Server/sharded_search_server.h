@@ -0,0 +1,78 @@
+#pragma once
+
+#include <memory>
+#include <shared_mutex>
+#include <string>
+#include <string_view>
+#include <vector>
+
+#include "search_server.h"
+
+// Access to one shard of a ShardedSearchServer. Only plain data crosses this interface,
+// so an implementation can forward the calls to another process
+class ShardTransport {
+public:
+    virtual ~ShardTransport() = default;
+
+    virtual void AddDocument(int document_id, std::string_view document, DocumentStatus status, const std::vector<int>& ratings) = 0;
+
+    virtual void RemoveDocument(int document_id) = 0;
+
+    [[nodiscard]] virtual size_t GetDocumentCount() const = 0;
+
+    [[nodiscard]] virtual CorpusStatistics GetQueryStatistics(std::string_view raw_query) const = 0;
+
+    [[nodiscard]] virtual std::vector<Document> FindTopDocuments(std::string_view raw_query, const CorpusStatistics& statistics,
+                                                                 DocumentStatus status) const = 0;
+};
+
+// Shard living in the same process. Updates take an exclusive lock, searches a shared one
+class LocalShard : public ShardTransport {
+public:
+    explicit LocalShard(std::string_view stop_words_text);
+
+    void AddDocument(int document_id, std::string_view document, DocumentStatus status, const std::vector<int>& ratings) override;
+
+    void RemoveDocument(int document_id) override;
+
+    [[nodiscard]] size_t GetDocumentCount() const override;
+
+    [[nodiscard]] CorpusStatistics GetQueryStatistics(std::string_view raw_query) const override;
+
+    [[nodiscard]] std::vector<Document> FindTopDocuments(std::string_view raw_query, const CorpusStatistics& statistics,
+                                                         DocumentStatus status) const override;
+
+private:
+    mutable std::shared_mutex mutex_;
+    SearchServer search_server_;
+};
+
+// Documents are hash-partitioned by id across independent shards. A query first gathers document
+// frequencies from all shards, then every shard scores with these global numbers, so relevance
+// equals the one of a single SearchServer holding all documents
+class ShardedSearchServer {
+public:
+    ShardedSearchServer(std::string_view stop_words_text, size_t shard_count);
+
+    explicit ShardedSearchServer(std::vector<std::unique_ptr<ShardTransport>> shards);
+
+    // Safe to call concurrently, calls for different shards run in parallel
+    void AddDocument(int document_id, std::string_view document, DocumentStatus status, const std::vector<int>& ratings);
+
+    // Shards are filled in parallel, each one in the order of documents
+    void AddDocuments(const std::vector<DocumentRecord>& documents);
+
+    void RemoveDocument(int document_id);
+
+    [[nodiscard]] size_t GetDocumentCount() const;
+
+    [[nodiscard]] size_t GetShardCount() const;
+
+    [[nodiscard]] std::vector<Document> FindTopDocuments(std::string_view raw_query, DocumentStatus status = DocumentStatus::ACTUAL) const;
+
+private:
+    [[nodiscard]] size_t GetShardIndex(int document_id) const;
+
+private:
+    std::vector<std::unique_ptr<ShardTransport>> shards_;
+};
@@ -1,7 +1,9 @@
 #include "string_processing.h"
 
-std::vector<std::string_view> SplitIntoWords(std::string_view text){
-    std::vector<std::string_view> result;
+namespace {
+
+template <typename Container>
+void AppendWords(std::string_view text, Container& result) {
     const int64_t pos_end = text.npos;
     while (true) {
         int64_t space = text.find(' ', 0);
@@ -12,6 +14,36 @@ std::vector<std::string_view> SplitIntoWords(std::string_view text){
             text.remove_prefix(space + 1);
         }
     }
+}
+
+} // namespace
 
+std::vector<std::string_view> SplitIntoWords(std::string_view text) {
+    std::vector<std::string_view> result;
+    AppendWords(text, result);
     return result;
-}
\ No newline at end of file
+}
+
+std::pmr::vector<std::string_view> SplitIntoWords(std::string_view text, std::pmr::memory_resource* resource) {
+    std::pmr::vector<std::string_view> result(resource);
+    AppendWords(text, result);
+    return result;
+}
+
+void AppendEscapedHtml(std::string& out, std::string_view text) {
+    for (const char c : text) {
+        switch (c) {
+            case '&':
+                out += "&amp;";
+                break;
+            case '<':
+                out += "&lt;";
+                break;
+            case '>':
+                out += "&gt;";
+                break;
+            default:
+                out.push_back(c);
+        }
+    }
+}
@@ -1,11 +1,19 @@
 #pragma once
 
+#include <memory_resource>
+#include <string>
 #include <string_view>
 #include <vector>
 #include <set>
 
 std::vector<std::string_view> SplitIntoWords(std::string_view text);
 
+// Same words, the vector is allocated from resource
+std::pmr::vector<std::string_view> SplitIntoWords(std::string_view text, std::pmr::memory_resource* resource);
+
+// Appends text with &, < and > replaced by HTML entities
+void AppendEscapedHtml(std::string& out, std::string_view text);
+
 //template <typename StringContainer>
 //std::set<std::string> MakeUniqueNonEmptyStrings(const StringContainer& strings) {
 //    std::set<std::string> non_empty_strings;
@@ -1 +1,183 @@
-// в качестве заготовки кода используйте последнюю версию своей поисковой системы
\ No newline at end of file
+#include "test_example_functions.h"
+
+#include "persistent_search_server.h"
+#include "search_scheduler.h"
+
+#include <chrono>
+#include <filesystem>
+#include <fstream>
+#include <future>
+#include <memory>
+#include <stdexcept>
+
+string GenerateWord(mt19937& generator, int max_length) {
+    const int length = uniform_int_distribution(1, max_length)(generator);
+    string word;
+    word.reserve(length);
+    for (int i = 0; i < length; ++i) {
+        word.push_back(uniform_int_distribution('a', 'z')(generator));
+    }
+    return word;
+}
+
+vector<string> GenerateDictionary(mt19937& generator, int word_count, int max_length) {
+    vector<string> words;
+    words.reserve(word_count);
+    for (int i = 0; i < word_count; ++i) {
+        words.push_back(GenerateWord(generator, max_length));
+    }
+    words.erase(unique(words.begin(), words.end()), words.end());
+    return words;
+}
+
+string GenerateQuery(mt19937& generator, const vector<string>& dictionary, int word_count, double minus_prob) {
+    string query;
+    for (int i = 0; i < word_count; ++i) {
+        if (!query.empty()) {
+            query.push_back(' ');
+        }
+        if (uniform_real_distribution<>(0, 1)(generator) < minus_prob) {
+            query.push_back('-');
+        }
+        query += dictionary[uniform_int_distribution<int>(0, dictionary.size() - 1)(generator)];
+    }
+    return query;
+}
+
+vector<string> GenerateQueries(mt19937& generator, const vector<string>& dictionary, int query_count, int max_word_count) {
+    vector<string> queries;
+    queries.reserve(query_count);
+    for (int i = 0; i < query_count; ++i) {
+        queries.push_back(GenerateQuery(generator, dictionary, max_word_count));
+    }
+    return queries;
+}
+
+namespace {
+
+void Check(bool condition, string_view message) {
+    if (!condition) {
+        throw logic_error("TestSearchSchedulerLoadShedding: "s + string(message));
+    }
+}
+
+void CheckRecovered(const SearchServer& search_server, const map<int, string>& documents, string_view message) {
+    bool is_recovered = search_server.GetDocumentCount() == documents.size();
+    for (const auto& [document_id, text] : documents) {
+        is_recovered = is_recovered && search_server.GetDocumentText(document_id) == text;
+    }
+    if (!is_recovered) {
+        throw logic_error("TestPersistentSearchServerRecovery: "s + string(message));
+    }
+}
+
+} // namespace
+
+void TestSearchSchedulerLoadShedding() {
+    SearchServer search_server("and with"s);
+    search_server.AddDocument(1, "white cat and yellow hat"s, DocumentStatus::ACTUAL, {1, 2});
+    search_server.AddDocument(2, "curly cat curly tail"s, DocumentStatus::ACTUAL, {1, 2});
+
+    // The only worker waits for a batch larger than the queue within a window longer than the test,
+    // so the accepted requests stay in the queue until the scheduler is destroyed
+    SchedulerOptions options;
+    options.batch_window = chrono::hours(1);
+    options.max_batch_size = 16;
+    options.queue_capacity = 4;
+    options.worker_count = 1;
+    auto scheduler = make_unique<SearchScheduler>(search_server, options);
+
+    SearchOptions expired_options;
+    expired_options.deadline = SearchOptions::Clock::now();
+    future<SearchResult> expired = scheduler->SearchAsync("cat"s, expired_options);
+    vector<future<SearchResult>> results;
+    for (int i = 0; i < 10; ++i) {
+        results.push_back(scheduler->SearchAsync("curly cat"s));
+    }
+    const SchedulerStatistics statistics = scheduler->GetStatistics();
+    Check(statistics.accepted + statistics.rejected == 11, "request was neither accepted nor rejected"sv);
+    Check(statistics.accepted == 4 && statistics.rejected == 7, "queue capacity is not enforced"sv);
+
+    // The destructor searches the queued requests
+    scheduler.reset();
+    int found_count = 0;
+    int rejected_count = 0;
+    for (auto& result : results) {
+        try {
+            Check(result.get().documents.size() == 2, "accepted request found wrong documents"sv);
+            ++found_count;
+        } catch (const SchedulerOverloaded&) {
+            ++rejected_count;
+        }
+    }
+    Check(found_count == 3 && rejected_count == 7, "wrong requests were rejected"sv);
+    const SearchResult expired_result = expired.get();
+    Check(expired_result.is_partial && expired_result.documents.empty(), "expired request was searched"sv);
+}
+
+void TestPersistentSearchServerRecovery() {
+    const filesystem::path directory = filesystem::temp_directory_path() / "search_server_recovery_test"s;
+    filesystem::remove_all(directory);
+    filesystem::create_directories(directory);
+
+    // Texts of a few hundred bytes fill several blocks of the document store
+    mt19937 generator(7);
+    const vector<string> dictionary = GenerateDictionary(generator, 1000, 10);
+    map<int, string> documents;
+    vector<DocumentRecord> records;
+    for (int document_id = 0; document_id < 300; ++document_id) {
+        documents[document_id] = GenerateQuery(generator, dictionary, 80);
+        records.push_back({document_id, documents[document_id], DocumentStatus::ACTUAL, {1, 2, 3}});
+    }
+
+    PersistentSearchServer::Options options;
+    options.log.sync = false;
+    {
+        PersistentSearchServer server(""s, directory.string(), options);
+        server.AddDocuments(records);
+        server.RemoveDocument(0);
+        documents.erase(0);
+    }
+    {
+        PersistentSearchServer server(""s, directory.string(), options);
+        CheckRecovered(server.GetSearchServer(), documents, "log replay lost documents"sv);
+    }
+
+    // A crash in the middle of a write leaves a part of the last record
+    string torn_record;
+    SerializeLogRecord(torn_record, LogRecord::Type::ADD, 1000, DocumentStatus::ACTUAL, {1}, "torn record"s);
+    ofstream(directory / "wal"s, ios::binary | ios::app) << torn_record.substr(0, torn_record.size() / 2);
+    {
+        PersistentSearchServer server(""s, directory.string(), options);
+        CheckRecovered(server.GetSearchServer(), documents, "torn tail broke log replay"sv);
+        // Records appended after the dropped tail must be readable
+        server.AddDocument(1001, "after torn tail"s, DocumentStatus::ACTUAL, {1});
+        documents[1001] = "after torn tail"s;
+    }
+    {
+        PersistentSearchServer server(""s, directory.string(), options);
+        CheckRecovered(server.GetSearchServer(), documents, "record after torn tail was lost"sv);
+        server.Checkpoint();
+        server.RemoveDocument(1);
+        documents.erase(1);
+        server.AddDocument(1002, "after checkpoint"s, DocumentStatus::BANNED, {1});
+        documents[1002] = "after checkpoint"s;
+    }
+    {
+        PersistentSearchServer server(""s, directory.string(), options);
+        CheckRecovered(server.GetSearchServer(), documents, "snapshot and log replay lost documents"sv);
+        if (server.GetSearchServer().GetDocumentStatus(1002) != DocumentStatus::BANNED) {
+            throw logic_error("TestPersistentSearchServerRecovery: status was not recovered"s);
+        }
+    }
+
+    // A record with a status out of DocumentStatus is corrupted
+    string bad_status_record;
+    SerializeLogRecord(bad_status_record, LogRecord::Type::ADD, 1, static_cast<DocumentStatus>(7), {1}, "cat"s);
+    ofstream(directory / "bad_status"s, ios::binary) << bad_status_record;
+    if (ReadLogRecords((directory / "bad_status"s).string(), [](const LogRecord&) {}) != 0) {
+        throw logic_error("TestPersistentSearchServerRecovery: invalid status was accepted"s);
+    }
+
+    filesystem::remove_all(directory);
+}
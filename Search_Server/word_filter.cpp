@@ -0,0 +1,154 @@
+#include "word_filter.h"
+
+#include <algorithm>
+
+namespace {
+
+size_t RoundUpToPowerOfTwo(size_t value) {
+    size_t result = 1;
+    while (result < value) {
+        result <<= 1;
+    }
+    return result;
+}
+
+} // namespace
+
+[[nodiscard]] uint64_t HashWord(std::string_view word, uint64_t seed) {
+    // FNV-1a with a murmur finalizer, so every bit of the result depends on the seed
+    uint64_t hash = 14695981039346656037ull ^ (seed * 0x9e3779b97f4a7c15ull);
+    for (const char c : word) {
+        hash ^= static_cast<uint8_t>(c);
+        hash *= 1099511628211ull;
+    }
+    hash ^= hash >> 33;
+    hash *= 0xff51afd7ed558ccdull;
+    hash ^= hash >> 33;
+    hash *= 0xc4ceb9fe1a85ec53ull;
+    hash ^= hash >> 33;
+    return hash;
+}
+
+PerfectHashSet::PerfectHashSet(std::vector<std::string_view> words) {
+    sort(words.begin(), words.end());
+    words.erase(unique(words.begin(), words.end()), words.end());
+    size_ = words.size();
+    if (words.empty()) {
+        return;
+    }
+
+    slots_.resize(RoundUpToPowerOfTwo(2 * words.size()));
+    while (!TryBuild(words)) {
+        slots_.resize(slots_.size() * 2);
+    }
+}
+
+[[nodiscard]] bool PerfectHashSet::Contains(std::string_view word) const {
+    if (slots_.empty()) {
+        return false;
+    }
+    const size_t slot = GetSlot(word, bucket_seeds_[GetBucket(word)]);
+    return is_slot_used_[slot] && slots_[slot] == word;
+}
+
+[[nodiscard]] size_t PerfectHashSet::GetSize() const {
+    return size_;
+}
+
+[[nodiscard]] bool PerfectHashSet::TryBuild(const std::vector<std::string_view>& words) {
+    bucket_seeds_.assign(std::max<size_t>(words.size() / 4, 1), 0);
+    std::fill(slots_.begin(), slots_.end(), std::string_view());
+    is_slot_used_.assign(slots_.size(), false);
+
+    std::vector<std::vector<std::string_view>> buckets(bucket_seeds_.size());
+    for (std::string_view word : words) {
+        buckets[GetBucket(word)].push_back(word);
+    }
+    std::vector<size_t> bucket_order(buckets.size());
+    for (size_t i = 0; i < bucket_order.size(); ++i) {
+        bucket_order[i] = i;
+    }
+    // Large buckets are the hardest to place, so they go first while the table is empty
+    sort(bucket_order.begin(), bucket_order.end(), [&buckets](size_t lhs, size_t rhs) {
+        return buckets[lhs].size() > buckets[rhs].size();
+    });
+
+    std::vector<size_t> bucket_slots;
+    for (const size_t bucket : bucket_order) {
+        if (buckets[bucket].empty()) {
+            break;
+        }
+        bool is_placed = false;
+        for (uint32_t seed = 1; seed <= kMaxSeedAttempts && !is_placed; ++seed) {
+            bucket_slots.clear();
+            is_placed = true;
+            for (std::string_view word : buckets[bucket]) {
+                const size_t slot = GetSlot(word, seed);
+                if (is_slot_used_[slot] || find(bucket_slots.begin(), bucket_slots.end(), slot) != bucket_slots.end()) {
+                    is_placed = false;
+                    break;
+                }
+                bucket_slots.push_back(slot);
+            }
+            if (is_placed) {
+                bucket_seeds_[bucket] = seed;
+                for (size_t i = 0; i < bucket_slots.size(); ++i) {
+                    slots_[bucket_slots[i]] = buckets[bucket][i];
+                    is_slot_used_[bucket_slots[i]] = true;
+                }
+            }
+        }
+        if (!is_placed) {
+            return false;
+        }
+    }
+    return true;
+}
+
+[[nodiscard]] size_t PerfectHashSet::GetBucket(std::string_view word) const {
+    return HashWord(word) % bucket_seeds_.size();
+}
+
+[[nodiscard]] size_t PerfectHashSet::GetSlot(std::string_view word, uint32_t seed) const {
+    return HashWord(word, seed) & (slots_.size() - 1);
+}
+
+BloomFilter::BloomFilter(size_t capacity)
+        : capacity_(capacity) {
+    const size_t bit_count = RoundUpToPowerOfTwo(std::max<size_t>(capacity * kBitsPerWord, 64));
+    bits_.assign(bit_count / 64, 0);
+    bit_mask_ = bit_count - 1;
+}
+
+void BloomFilter::Add(std::string_view word) {
+    const uint64_t hash = HashWord(word);
+    // Double hashing: the probes are h1 + i * h2
+    const uint64_t step = (hash >> 32) | 1;
+    uint64_t position = hash;
+    for (int i = 0; i < kHashCount; ++i, position += step) {
+        const uint64_t bit = position & bit_mask_;
+        bits_[bit / 64] |= uint64_t{1} << (bit % 64);
+    }
+    ++size_;
+}
+
+[[nodiscard]] bool BloomFilter::MayContain(std::string_view word) const {
+    const uint64_t hash = HashWord(word);
+    const uint64_t step = (hash >> 32) | 1;
+    uint64_t position = hash;
+    for (int i = 0; i < kHashCount; ++i, position += step) {
+        const uint64_t bit = position & bit_mask_;
+        if ((bits_[bit / 64] & (uint64_t{1} << (bit % 64))) == 0) {
+            return false;
+        }
+    }
+    return true;
+}
+
+[[nodiscard]] size_t BloomFilter::GetSize() const {
+    return size_;
+}
+
+[[nodiscard]] size_t BloomFilter::GetCapacity() const {
+    return capacity_;
+}
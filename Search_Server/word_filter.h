@@ -0,0 +1,61 @@
+#pragma once
+
+#include <cstdint>
+#include <string_view>
+#include <vector>
+
+[[nodiscard]] uint64_t HashWord(std::string_view word, uint64_t seed = 0);
+
+// Static set with a collision-free slot for every word (hash and displace): a lookup is two hashes
+// and at most one comparison. Words must outlive the set
+class PerfectHashSet {
+public:
+    PerfectHashSet() = default;
+
+    explicit PerfectHashSet(std::vector<std::string_view> words);
+
+    [[nodiscard]] bool Contains(std::string_view word) const;
+
+    [[nodiscard]] size_t GetSize() const;
+
+private:
+    // Searched seeds per bucket before the table is doubled
+    static constexpr uint32_t kMaxSeedAttempts = 1 << 16;
+
+private:
+    [[nodiscard]] bool TryBuild(const std::vector<std::string_view>& words);
+
+    [[nodiscard]] size_t GetBucket(std::string_view word) const;
+
+    [[nodiscard]] size_t GetSlot(std::string_view word, uint32_t seed) const;
+
+private:
+    std::vector<uint32_t> bucket_seeds_;
+    std::vector<std::string_view> slots_;
+    std::vector<bool> is_slot_used_;
+    size_t size_ = 0;
+};
+
+// Bloom filter: no false negatives, about 1% false positives while no more than capacity words are added
+class BloomFilter {
+public:
+    explicit BloomFilter(size_t capacity = 0);
+
+    void Add(std::string_view word);
+
+    [[nodiscard]] bool MayContain(std::string_view word) const;
+
+    [[nodiscard]] size_t GetSize() const;
+
+    [[nodiscard]] size_t GetCapacity() const;
+
+private:
+    static constexpr size_t kBitsPerWord = 10;
+    static constexpr int kHashCount = 7;
+
+private:
+    std::vector<uint64_t> bits_;
+    uint64_t bit_mask_ = 0;
+    size_t size_ = 0;
+    size_t capacity_ = 0;
+};
@@ -0,0 +1,274 @@
+#include "write_ahead_log.h"
+
+#include <cerrno>
+#include <cstring>
+#include <fstream>
+#include <iterator>
+#include <stdexcept>
+
+#include <fcntl.h>
+#include <unistd.h>
+
+using namespace std::string_literals;
+
+namespace {
+
+// size + checksum
+constexpr size_t kRecordHeaderSize = 8;
+
+uint32_t ComputeChecksum(std::string_view data) {
+    // FNV-1a
+    uint32_t hash = 2166136261u;
+    for (const char c : data) {
+        hash ^= static_cast<uint8_t>(c);
+        hash *= 16777619u;
+    }
+    return hash;
+}
+
+template <typename Value>
+void WriteValue(std::string& out, Value value) {
+    char bytes[sizeof(Value)];
+    std::memcpy(bytes, &value, sizeof(Value));
+    out.append(bytes, sizeof(Value));
+}
+
+template <typename Value>
+bool ReadValue(std::string_view& in, Value& value) {
+    if (in.size() < sizeof(Value)) {
+        return false;
+    }
+    std::memcpy(&value, in.data(), sizeof(Value));
+    in.remove_prefix(sizeof(Value));
+    return true;
+}
+
+bool ParsePayload(std::string_view payload, LogRecord& record) {
+    uint8_t type = 0;
+    if (!ReadValue(payload, type) || !ReadValue(payload, record.document_id)) {
+        return false;
+    }
+    record.type = static_cast<LogRecord::Type>(type);
+    if (record.type == LogRecord::Type::REMOVE) {
+        return payload.empty();
+    }
+    if (record.type != LogRecord::Type::ADD) {
+        return false;
+    }
+
+    uint8_t status = 0;
+    uint32_t rating_count = 0;
+    if (!ReadValue(payload, status) || !ReadValue(payload, rating_count)) {
+        return false;
+    }
+    if (status > static_cast<uint8_t>(DocumentStatus::REMOVED)) {
+        return false;
+    }
+    record.status = static_cast<DocumentStatus>(status);
+    record.ratings.resize(rating_count);
+    for (int& rating : record.ratings) {
+        if (!ReadValue(payload, rating)) {
+            return false;
+        }
+    }
+    uint32_t text_size = 0;
+    if (!ReadValue(payload, text_size) || payload.size() != text_size) {
+        return false;
+    }
+    record.text = std::string(payload);
+    return true;
+}
+
+std::runtime_error MakeSystemError(const std::string& message) {
+    return std::runtime_error(message + ": "s + std::strerror(errno));
+}
+
+} // namespace
+
+void SerializeLogRecord(std::string& out, LogRecord::Type type, int document_id, DocumentStatus status,
+                        const std::vector<int>& ratings, std::string_view text) {
+    std::string payload;
+    WriteValue(payload, static_cast<uint8_t>(type));
+    WriteValue(payload, document_id);
+    if (type == LogRecord::Type::ADD) {
+        WriteValue(payload, static_cast<uint8_t>(status));
+        WriteValue(payload, static_cast<uint32_t>(ratings.size()));
+        for (const int rating : ratings) {
+            WriteValue(payload, rating);
+        }
+        WriteValue(payload, static_cast<uint32_t>(text.size()));
+        payload.append(text);
+    }
+    WriteValue(out, static_cast<uint32_t>(payload.size()));
+    WriteValue(out, ComputeChecksum(payload));
+    out += payload;
+}
+
+size_t ReadLogRecords(const std::string& path, const std::function<void(const LogRecord&)>& handler, LogReadMode mode) {
+    std::ifstream input(path, std::ios::binary);
+    if (!input) {
+        return 0;
+    }
+    const std::string data((std::istreambuf_iterator<char>(input)), std::istreambuf_iterator<char>());
+
+    std::string_view rest = data;
+    LogRecord record;
+    while (rest.size() >= kRecordHeaderSize) {
+        std::string_view header = rest.substr(0, kRecordHeaderSize);
+        uint32_t payload_size = 0;
+        uint32_t checksum = 0;
+        ReadValue(header, payload_size);
+        ReadValue(header, checksum);
+        if (rest.size() - kRecordHeaderSize < payload_size) {
+            break;
+        }
+        const std::string_view payload = rest.substr(kRecordHeaderSize, payload_size);
+        if (ComputeChecksum(payload) != checksum || !ParsePayload(payload, record)) {
+            break;
+        }
+        handler(record);
+        rest.remove_prefix(kRecordHeaderSize + payload_size);
+    }
+    if (mode == LogReadMode::STRICT && !rest.empty()) {
+        throw std::runtime_error("Corrupted record at offset "s + std::to_string(data.size() - rest.size()) + " of "s + path);
+    }
+    return data.size() - rest.size();
+}
+
+WriteAheadLog::WriteAheadLog(const std::string& path)
+    : WriteAheadLog(path, Options{}) {
+}
+
+WriteAheadLog::WriteAheadLog(const std::string& path, Options options)
+    : path_(path)
+    , options_(options) {
+    const size_t valid_size = ReadLogRecords(path_, [](const LogRecord&) {});
+    fd_ = open(path_.c_str(), O_WRONLY | O_CREAT | O_APPEND, 0644);
+    if (fd_ < 0) {
+        throw MakeSystemError("Cannot open log "s + path_);
+    }
+    // The dropped tail must not reappear after a crash behind records appended to the shorter file
+    if (ftruncate(fd_, static_cast<off_t>(valid_size)) != 0 || (options_.sync && fsync(fd_) != 0)) {
+        close(fd_);
+        throw MakeSystemError("Cannot truncate log "s + path_);
+    }
+    flusher_ = std::thread([this] { RunFlusher(); });
+}
+
+WriteAheadLog::~WriteAheadLog() {
+    {
+        std::lock_guard guard(mutex_);
+        stop_ = true;
+    }
+    flusher_cv_.notify_one();
+    flusher_.join();
+    close(fd_);
+}
+
+uint64_t WriteAheadLog::AppendAdd(int document_id, std::string_view document, DocumentStatus status, const std::vector<int>& ratings) {
+    std::string record;
+    SerializeLogRecord(record, LogRecord::Type::ADD, document_id, status, ratings, document);
+    return Append(record);
+}
+
+uint64_t WriteAheadLog::AppendRemove(int document_id) {
+    std::string record;
+    SerializeLogRecord(record, LogRecord::Type::REMOVE, document_id);
+    return Append(record);
+}
+
+void WriteAheadLog::WaitDurable(uint64_t lsn) {
+    std::unique_lock lock(mutex_);
+    ++waiters_;
+    flusher_cv_.notify_one();
+    durable_cv_.wait(lock, [this, lsn] { return durable_lsn_ >= lsn || !error_.empty(); });
+    --waiters_;
+    if (durable_lsn_ < lsn) {
+        throw std::runtime_error(error_);
+    }
+}
+
+void WriteAheadLog::Flush() {
+    uint64_t lsn;
+    {
+        std::lock_guard guard(mutex_);
+        lsn = appended_lsn_;
+    }
+    WaitDurable(lsn);
+}
+
+void WriteAheadLog::Truncate() {
+    Flush();
+    std::lock_guard guard(mutex_);
+    if (ftruncate(fd_, 0) != 0 || (options_.sync && fdatasync(fd_) != 0)) {
+        throw MakeSystemError("Cannot truncate log "s + path_);
+    }
+}
+
+uint64_t WriteAheadLog::Append(std::string_view record) {
+    std::lock_guard guard(mutex_);
+    if (!error_.empty()) {
+        throw std::runtime_error(error_);
+    }
+    if (buffer_.empty()) {
+        buffer_start_time_ = std::chrono::steady_clock::now();
+    }
+    buffer_.append(record);
+    if (buffer_.size() >= options_.group_commit_bytes) {
+        flusher_cv_.notify_one();
+    }
+    return ++appended_lsn_;
+}
+
+void WriteAheadLog::RunFlusher() {
+    std::unique_lock lock(mutex_);
+    while (true) {
+        flusher_cv_.wait_for(lock, options_.group_commit_interval, [this] {
+            return stop_ || (!buffer_.empty() && (waiters_ > 0 || buffer_.size() >= options_.group_commit_bytes));
+        });
+        if (buffer_.empty()) {
+            if (stop_) {
+                return;
+            }
+            continue;
+        }
+        if (!stop_ && waiters_ == 0 && buffer_.size() < options_.group_commit_bytes
+            && std::chrono::steady_clock::now() - buffer_start_time_ < options_.group_commit_interval) {
+            continue;
+        }
+
+        std::string batch;
+        batch.swap(buffer_);
+        const uint64_t batch_lsn = appended_lsn_;
+        lock.unlock();
+        std::string error;
+        try {
+            WriteToFile(batch);
+        } catch (const std::runtime_error& e) {
+            error = e.what();
+        }
+        lock.lock();
+        if (error.empty()) {
+            durable_lsn_ = batch_lsn;
+        } else {
+            error_ = error;
+        }
+        durable_cv_.notify_all();
+    }
+}
+
+void WriteAheadLog::WriteToFile(std::string_view data) {
+    while (!data.empty()) {
+        const ssize_t written = write(fd_, data.data(), data.size());
+        if (written < 0) {
+            if (errno == EINTR) {
+                continue;
+            }
+            throw MakeSystemError("Cannot write log "s + path_);
+        }
+        data.remove_prefix(static_cast<size_t>(written));
+    }
+    if (options_.sync && fdatasync(fd_) != 0) {
+        throw MakeSystemError("Cannot sync log "s + path_);
+    }
+}
@@ -0,0 +1,104 @@
+#pragma once
+
+#include <chrono>
+#include <condition_variable>
+#include <cstdint>
+#include <functional>
+#include <mutex>
+#include <string>
+#include <string_view>
+#include <thread>
+#include <vector>
+
+#include "search_server.h"
+
+struct LogRecord {
+    enum class Type : uint8_t {
+        ADD = 1,
+        REMOVE = 2,
+    };
+
+    Type type = Type::ADD;
+    int document_id = 0;
+    DocumentStatus status = DocumentStatus::ACTUAL;
+    std::vector<int> ratings;
+    std::string text;
+};
+
+// Appends a framed record (size, checksum, payload) to out
+void SerializeLogRecord(std::string& out, LogRecord::Type type, int document_id, DocumentStatus status = DocumentStatus::ACTUAL,
+                        const std::vector<int>& ratings = {}, std::string_view text = {});
+
+enum class LogReadMode {
+    // A torn or corrupted record, left by a crash in the middle of a write, ends the valid prefix
+    STOP_AT_TORN_TAIL,
+    // A torn or corrupted record throws, for files written completely before they are used, like snapshots
+    STRICT,
+};
+
+// Calls handler for every complete record of the file and returns the length of the valid prefix
+size_t ReadLogRecords(const std::string& path, const std::function<void(const LogRecord&)>& handler,
+                      LogReadMode mode = LogReadMode::STOP_AT_TORN_TAIL);
+
+// Append-only binary log of AddDocument / RemoveDocument calls. Records of concurrent writers are
+// collected in memory and written by a background thread with one fsync per batch (group commit)
+class WriteAheadLog {
+public:
+    struct Options {
+        // A batch is written once it grows to this size or its oldest record waits for interval
+        size_t group_commit_bytes = 1 << 20;
+        std::chrono::microseconds group_commit_interval{2000};
+        bool sync = true;
+    };
+
+    // Drops a torn tail of the existing file, then appends to it
+    explicit WriteAheadLog(const std::string& path);
+
+    WriteAheadLog(const std::string& path, Options options);
+
+    WriteAheadLog(const WriteAheadLog&) = delete;
+    WriteAheadLog& operator=(const WriteAheadLog&) = delete;
+
+    // Writes everything appended so far
+    ~WriteAheadLog();
+
+    // Returns the log sequence number of the record
+    uint64_t AppendAdd(int document_id, std::string_view document, DocumentStatus status, const std::vector<int>& ratings);
+
+    uint64_t AppendRemove(int document_id);
+
+    // Blocks until the record with the given sequence number is on disk
+    void WaitDurable(uint64_t lsn);
+
+    // Blocks until every appended record is on disk
+    void Flush();
+
+    // Flushes and empties the log, used once its records are saved in a snapshot.
+    // Must not run concurrently with appends
+    void Truncate();
+
+private:
+    uint64_t Append(std::string_view record);
+
+    void RunFlusher();
+
+    void WriteToFile(std::string_view data);
+
+private:
+    const std::string path_;
+    const Options options_;
+    int fd_ = -1;
+
+    std::mutex mutex_;
+    std::condition_variable flusher_cv_;
+    std::condition_variable durable_cv_;
+    std::string buffer_;
+    std::chrono::steady_clock::time_point buffer_start_time_;
+    uint64_t appended_lsn_ = 0;
+    uint64_t durable_lsn_ = 0;
+    size_t waiters_ = 0;
+    bool stop_ = false;
+    std::string error_;
+
+    std::thread flusher_;
+};